@@ -0,0 +1,54 @@
+#!/bin/sh
+# Goodput benchmark: sends files of several sizes through the impair proxy
+# under several impairment profiles and prints one CSV row per run.
+#
+# usage: scripts/bench.sh, or make bench. Set BENCH_SIZES (bytes) or
+# BENCH_PROFILES (name:impair flags, ; separated) to change the matrix,
+# and BENCH_TIMEOUT for the longest a run may take in seconds.
+
+cd "$(dirname "$0")/.." || exit 1
+
+SIZES=${BENCH_SIZES:-"1000000 16000000 64000000"}
+PROFILES=${BENCH_PROFILES:-"clean:;loss1:-l 1;loss5:-l 5;reorder:-o 5 -g 2000;duplicate:-u 5;jitter:-d 5 -j 5;wan:-d 10 -j 1 -l 0.5 -b 12500000"}
+TIMEOUT=${BENCH_TIMEOUT:-120}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+now() {
+    date +%s.%N
+}
+
+echo "profile,impairments,size_bytes,match,seconds,goodput_mbps,packets_sent,retransmits,retransmit_ratio"
+for size in $SIZES; do
+    head -c "$size" /dev/urandom > "$WORK/in.bin"
+    echo "$PROFILES" | tr ';' '\n' | while IFS=: read -r name flags; do
+        [ -n "$name" ] || continue
+        port=$((20000 + $(od -An -N2 -tu2 /dev/urandom) % 20000))
+        rm -f "$WORK/out.bin"
+        timeout "$TIMEOUT" ./receiver "$port" "$WORK/out.bin" 2>/dev/null &
+        receiver=$!
+        # shellcheck disable=SC2086 # flags are split on purpose
+        ./impair -s 1 $flags $((port + 1)) 127.0.0.1 "$port" 2>/dev/null &
+        proxy=$!
+        sleep 0.2
+
+        start=$(now)
+        timeout "$TIMEOUT" ./sender -v 127.0.0.1 $((port + 1)) "$WORK/in.bin" "$size" > /dev/null 2> "$WORK/sender.log"
+        wait "$receiver"
+        end=$(now)
+        kill "$proxy" 2>/dev/null
+        wait "$proxy" 2>/dev/null
+
+        match=no
+        cmp -s "$WORK/in.bin" "$WORK/out.bin" && match=yes
+        sent=$(sed -n 's/^sent \([0-9]*\) data packets, retransmitted \([0-9]*\).*/\1/p' "$WORK/sender.log")
+        resent=$(sed -n 's/^sent \([0-9]*\) data packets, retransmitted \([0-9]*\).*/\2/p' "$WORK/sender.log")
+        awk -v name="$name" -v flags="$flags" -v size="$size" -v matched="$match" -v start="$start" -v end="$end" \
+            -v sent="${sent:-0}" -v resent="${resent:-0}" 'BEGIN {
+            secs = end - start
+            goodput = secs > 0 && matched == "yes" ? size * 8 / secs / 1e6 : 0
+            ratio = sent > 0 ? resent / sent : 0
+            printf "%s,\"%s\",%d,%s,%.3f,%.1f,%d,%d,%.4f\n", name, flags, size, matched, secs, goodput, sent, resent, ratio
+        }'
+    done
+done
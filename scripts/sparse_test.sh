@@ -0,0 +1,68 @@
+#!/bin/sh
+# Large file test: sends a sparse file of over 4 GiB, with data at 0, 2 GiB,
+# 4 GiB and its end, through sender and receiver on loopback and compares
+# the copy. A second run uses binaries built with a small SEQ_BITS, so the
+# wire sequence numbers wrap hundreds of times on the way.
+#
+# usage: scripts/sparse_test.sh, or make sparse-test. Set SPARSE_SIZE
+# (bytes, at least 4 GiB plus 1 MiB), SPARSE_SEQ_BITS, SPARSE_DIR for where
+# the files go (it needs room for the copies) and SPARSE_TIMEOUT for the
+# longest a run may take in seconds. Exits non zero if a copy differs.
+
+cd "$(dirname "$0")/.." || exit 1
+
+SIZE=${SPARSE_SIZE:-4297064448}
+SEQ_BITS=${SPARSE_SEQ_BITS:-12}
+TIMEOUT=${SPARSE_TIMEOUT:-600}
+WORK=$(mktemp -d "${SPARSE_DIR:-${TMPDIR:-/tmp}}/sparse.XXXXXX") || exit 1
+trap 'rm -rf "$WORK"' EXIT
+MIB=1048576
+
+# writes a MiB of random data at a MiB offset without touching the rest
+put() {
+    head -c $MIB /dev/urandom | dd of="$WORK/in.bin" bs=$MIB seek="$1" conv=notrunc status=none
+}
+
+truncate -s "$SIZE" "$WORK/in.bin" || exit 1
+put 0
+put 2048
+put 4096
+put $((SIZE / MIB - 1))
+# the last, partial MiB is covered by the put above only when SIZE is a multiple of it
+head -c $((SIZE % MIB)) /dev/urandom | dd of="$WORK/in.bin" bs=1 seek=$((SIZE - SIZE % MIB)) conv=notrunc status=none
+
+# runs one transfer: $1 names it, $2 is the directory holding sender and
+# receiver, $3 and $4 are extra sender and receiver flags
+run() {
+    port=$((20000 + $(od -An -N2 -tu2 /dev/urandom) % 20000))
+    rm -f "$WORK/out.bin"
+    # shellcheck disable=SC2086 # flags are split on purpose
+    timeout "$TIMEOUT" "$2/receiver" $4 "$port" "$WORK/out.bin" 2> "$WORK/receiver.log" &
+    receiver=$!
+    sleep 0.2
+    # shellcheck disable=SC2086
+    timeout "$TIMEOUT" "$2/sender" $3 127.0.0.1 "$port" "$WORK/in.bin" "$SIZE" > /dev/null 2> "$WORK/sender.log"
+    sent=$?
+    wait "$receiver"
+    received=$?
+    if [ "$sent" -eq 0 ] && [ "$received" -eq 0 ] && cmp "$WORK/in.bin" "$WORK/out.bin"; then
+        echo "$1: ok"
+        return 0
+    fi
+    echo "$1: FAILED, sender exited $sent, receiver $received"
+    cat "$WORK/sender.log" "$WORK/receiver.log"
+    return 1
+}
+
+failed=0
+run "$SIZE bytes" . "" "" || failed=1
+
+# the windows must stay under half the sequence space for seq_unwrap()
+window=$((1 << (SEQ_BITS - 2)))
+mkdir "$WORK/small"
+for program in sender receiver; do
+    ${CC:-cc} -O2 -DSEQ_BITS="$SEQ_BITS" -o "$WORK/small/$program" "src/$program.c" \
+        $(ls src/*.c | grep -v -e src/sender.c -e src/receiver.c -e src/impair.c) -lpthread -lm || exit 1
+done
+run "$SIZE bytes, $SEQ_BITS bit sequence numbers" "$WORK/small" "-w $window" "-b $window" || failed=1
+exit $failed
@@ -0,0 +1,317 @@
+/*
+@file batch_io.c
+@brief batched UDP send and receive with sendmmsg/recvmmsg
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#define _GNU_SOURCE // for sendmmsg/recvmmsg
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/udp.h>
+
+#include "batch_io.h"
+
+#define TX_CONTROL_SIZE CMSG_SPACE(sizeof(uint16_t))
+#define RX_CONTROL_SIZE CMSG_SPACE(sizeof(int))
+
+int batch_io_init(struct batch_io *io, int sockfd, int size, size_t max_datagram){
+    memset(io, 0, sizeof(*io));
+    if(size < 1) size = 1;
+    if(size > MAX_BATCH_SIZE) size = MAX_BATCH_SIZE;
+    io->sockfd = sockfd;
+    io->size = size;
+    io->max_datagram = max_datagram;
+    io->rx_buf_size = max_datagram;
+    io->rx_segs_capacity = size;
+
+    io->tx_msgs = calloc(size, sizeof(struct mmsghdr));
+    io->tx_iovs = calloc(size * BATCH_MAX_IOV, sizeof(struct iovec));
+    io->tx_first_iov = calloc(size + 1, sizeof(int));
+    io->tx_lens = calloc(size, sizeof(size_t));
+    io->tx_addrs = calloc(size, sizeof(struct sockaddr_in));
+    io->tx_segments = calloc(size, sizeof(int));
+    io->tx_control = calloc(size, TX_CONTROL_SIZE);
+    io->tx_copies = malloc(size * max_datagram);
+    io->rx_msgs = calloc(size, sizeof(struct mmsghdr));
+    io->rx_iovs = calloc(size, sizeof(struct iovec));
+    io->rx_addrs = calloc(size, sizeof(struct sockaddr_in));
+    io->rx_control = calloc(size, RX_CONTROL_SIZE);
+    io->rx_bufs = malloc(size * max_datagram);
+    io->rx_segs = calloc(size, sizeof(struct batch_segment));
+    if(io->tx_msgs == NULL || io->tx_iovs == NULL || io->tx_first_iov == NULL || io->tx_lens == NULL ||
+       io->tx_addrs == NULL || io->tx_segments == NULL ||
+       io->tx_control == NULL || io->tx_copies == NULL || io->rx_msgs == NULL || io->rx_iovs == NULL ||
+       io->rx_addrs == NULL || io->rx_control == NULL || io->rx_bufs == NULL || io->rx_segs == NULL){
+        perror("batch io malloc failed");
+        batch_io_free(io);
+        return 0;
+    }
+    return 1;
+}
+
+void batch_io_free(struct batch_io *io){
+    free(io->tx_msgs);
+    free(io->tx_iovs);
+    free(io->tx_first_iov);
+    free(io->tx_lens);
+    free(io->tx_addrs);
+    free(io->tx_segments);
+    free(io->tx_control);
+    free(io->tx_copies);
+    free(io->rx_msgs);
+    free(io->rx_iovs);
+    free(io->rx_addrs);
+    free(io->rx_control);
+    free(io->rx_bufs);
+    free(io->rx_segs);
+    memset(io, 0, sizeof(*io));
+}
+
+int batch_io_enable_gso(struct batch_io *io){
+    // a segment size of 0 leaves plain sends alone, it only checks the kernel knows the option
+    int off = 0;
+    if(setsockopt(io->sockfd, SOL_UDP, UDP_SEGMENT, &off, sizeof(off)) < 0){
+        io->gso = 0;
+        return 0;
+    }
+    io->gso = 1;
+    return 1;
+}
+
+int batch_io_enable_gro(struct batch_io *io){
+    char *bufs = malloc((size_t)io->size * GRO_BUFFER_SIZE);
+    if(bufs == NULL){
+        perror("batch io malloc failed");
+        return 0;
+    }
+    int on = 1;
+    if(setsockopt(io->sockfd, SOL_UDP, UDP_GRO, &on, sizeof(on)) < 0){
+        free(bufs);
+        return 0;
+    }
+    free(io->rx_bufs);
+    io->rx_bufs = bufs;
+    io->rx_buf_size = GRO_BUFFER_SIZE;
+    io->gro = 1;
+    return 1;
+}
+
+int batch_io_queue_iov(struct batch_io *io, const struct iovec *iov, int iovcnt, const struct sockaddr_in *to){
+    if(io->tx_count == io->size && batch_io_flush(io) == 0) return 0;
+
+    int i = io->tx_count++;
+    int first = io->tx_first_iov[i];
+    size_t len = 0;
+    for(int k = 0; k < iovcnt; k++){
+        io->tx_iovs[first + k] = iov[k];
+        len += iov[k].iov_len;
+    }
+    io->tx_first_iov[i + 1] = first + iovcnt;
+    io->tx_lens[i] = len;
+    io->tx_addrs[i] = *to;
+    return 1;
+}
+
+int batch_io_queue(struct batch_io *io, const void *data, size_t len, const struct sockaddr_in *to, int copy){
+    if(io->tx_count == io->size && batch_io_flush(io) == 0) return 0;
+
+    if(copy){
+        char *slot = io->tx_copies + (size_t)io->tx_count * io->max_datagram;
+        memcpy(slot, data, len);
+        data = slot;
+    }
+    struct iovec iov;
+    iov.iov_base = (void *)data;
+    iov.iov_len = len;
+    return batch_io_queue_iov(io, &iov, 1, to);
+}
+
+/*
+@brief whether two queued datagrams go to the same address
+
+@param io: the batch
+@param a: one datagram
+@param b: the other
+
+@return 1 if they do, 0 otherwise
+*/
+static int same_destination(const struct batch_io *io, int a, int b){
+    return io->tx_addrs[a].sin_addr.s_addr == io->tx_addrs[b].sin_addr.s_addr &&
+           io->tx_addrs[a].sin_port == io->tx_addrs[b].sin_port;
+}
+
+/*
+@brief lays out the messages for the queued datagrams from first on
+
+Without GSO every datagram is its own message. With GSO, a run of
+datagrams to one address whose sizes match the first one's becomes a
+single message gathering every datagram's pieces with a UDP_SEGMENT
+cmsg, a shorter datagram may only end a run.
+
+@param io: the batch
+@param first: the first datagram to lay out
+
+@return the number of messages
+*/
+static int build_messages(struct batch_io *io, int first){
+    int msgs = 0;
+    for(int i = first; i < io->tx_count; msgs++){
+        size_t seg = io->tx_lens[i];
+        int n = 1;
+        if(io->gso){
+            int max = GSO_MAX_SEGMENTS;
+            if(seg * max > GSO_MAX_BYTES) max = GSO_MAX_BYTES / seg;
+            while(i + n < io->tx_count && n < max && same_destination(io, i, i + n) && io->tx_lens[i + n] <= seg){
+                n++;
+                if(io->tx_lens[i + n - 1] < seg) break;
+            }
+        }
+
+        struct msghdr *hdr = &io->tx_msgs[msgs].msg_hdr;
+        memset(hdr, 0, sizeof(*hdr));
+        hdr->msg_name = &io->tx_addrs[i];
+        hdr->msg_namelen = sizeof(struct sockaddr_in);
+        hdr->msg_iov = &io->tx_iovs[io->tx_first_iov[i]];
+        hdr->msg_iovlen = io->tx_first_iov[i + n] - io->tx_first_iov[i];
+        if(n > 1){
+            hdr->msg_control = io->tx_control + (size_t)msgs * TX_CONTROL_SIZE;
+            hdr->msg_controllen = TX_CONTROL_SIZE;
+            struct cmsghdr *cm = CMSG_FIRSTHDR(hdr);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t gso_size = seg;
+            memcpy(CMSG_DATA(cm), &gso_size, sizeof(gso_size));
+        }
+        io->tx_segments[msgs] = n;
+        i += n;
+    }
+    return msgs;
+}
+
+int batch_io_flush(struct batch_io *io){
+    int next = 0;   // first datagram not yet sent
+    while(next < io->tx_count){
+        int msgs = build_messages(io, next);
+        int sent = 0;
+        while(sent < msgs){
+            int n = sendmmsg(io->sockfd, io->tx_msgs + sent, msgs - sent, 0);
+            if(n < 0){
+                if(errno == EINTR) continue;
+                if(io->gso && (errno == EIO || errno == EINVAL || errno == EOPNOTSUPP)){
+                    // the device can't segment for us, lay the rest out again without GSO
+                    fprintf(stderr, "UDP GSO send failed, falling back to one datagram per message\n");
+                    io->gso = 0;
+                    break;
+                }
+                perror("sendmmsg failed");
+                io->tx_count = 0;
+                return 0;
+            }
+            io->stats.tx_calls++;
+            for(int m = sent; m < sent + n; m++){
+                io->stats.tx_datagrams += io->tx_segments[m];
+                next += io->tx_segments[m];
+            }
+            sent += n;
+        }
+    }
+    io->tx_count = 0;
+    return 1;
+}
+
+/*
+@brief the segment size the kernel reported for a coalesced message
+
+@param hdr: the received message
+
+@return the GRO segment size, or 0 if the message is a single datagram
+*/
+static size_t gro_segment_size(struct msghdr *hdr){
+    for(struct cmsghdr *cm = CMSG_FIRSTHDR(hdr); cm != NULL; cm = CMSG_NXTHDR(hdr, cm)){
+        if(cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO){
+            int size;
+            memcpy(&size, CMSG_DATA(cm), sizeof(size));
+            return size > 0 ? (size_t)size : 0;
+        }
+    }
+    return 0;
+}
+
+int batch_io_recv(struct batch_io *io, int flags){
+    for(int i = 0; i < io->size; i++){
+        io->rx_iovs[i].iov_base = io->rx_bufs + (size_t)i * io->rx_buf_size;
+        io->rx_iovs[i].iov_len = io->rx_buf_size;
+        struct msghdr *hdr = &io->rx_msgs[i].msg_hdr;
+        memset(hdr, 0, sizeof(*hdr));
+        hdr->msg_name = &io->rx_addrs[i];
+        hdr->msg_namelen = sizeof(struct sockaddr_in);
+        hdr->msg_iov = &io->rx_iovs[i];
+        hdr->msg_iovlen = 1;
+        if(io->gro){
+            hdr->msg_control = io->rx_control + (size_t)i * RX_CONTROL_SIZE;
+            hdr->msg_controllen = RX_CONTROL_SIZE;
+        }
+    }
+
+    int n = recvmmsg(io->sockfd, io->rx_msgs, io->size, flags, NULL);
+    if(n < 0){
+        io->rx_count = 0;
+        if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+        perror("recvmmsg failed");
+        return -1;
+    }
+    io->stats.rx_calls++;
+
+    // cut every message into its datagrams
+    int count = 0;
+    for(int m = 0; m < n; m++){
+        char *data = io->rx_iovs[m].iov_base;
+        size_t len = io->rx_msgs[m].msg_len;
+        size_t seg = io->gro ? gro_segment_size(&io->rx_msgs[m].msg_hdr) : 0;
+        if(seg == 0 || seg > len) seg = len;
+        size_t pieces = len == 0 ? 1 : (len + seg - 1) / seg;
+
+        if(count + (int)pieces > io->rx_segs_capacity){
+            int capacity = io->rx_segs_capacity;
+            while(capacity < count + (int)pieces) capacity *= 2;
+            struct batch_segment *segs = realloc(io->rx_segs, capacity * sizeof(struct batch_segment));
+            if(segs == NULL){
+                perror("batch io malloc failed");
+                break;
+            }
+            io->rx_segs = segs;
+            io->rx_segs_capacity = capacity;
+        }
+        for(size_t off = 0, p = 0; p < pieces; p++, off += seg){
+            io->rx_segs[count].data = data + off;
+            io->rx_segs[count].len = len - off < seg ? len - off : seg;
+            io->rx_segs[count].msg = m;
+            count++;
+        }
+    }
+    io->stats.rx_datagrams += count;
+    io->rx_count = count;
+    return count;
+}
+
+char *batch_io_datagram(struct batch_io *io, int i, size_t *len, struct sockaddr_in *from){
+    *len = io->rx_segs[i].len;
+    if(from != NULL) *from = io->rx_addrs[io->rx_segs[i].msg];
+    return io->rx_segs[i].data;
+}
+
+void batch_io_print_stats(const struct batch_io *io, FILE *out){
+    const struct batch_stats *st = &io->stats;
+    fprintf(out, "batch size %d%s%s: sent %llu datagrams in %llu calls (%.1f per call), received %llu in %llu calls (%.1f per call)\n",
+            io->size, io->gso ? " gso" : "", io->gro ? " gro" : "",
+            (unsigned long long)st->tx_datagrams, (unsigned long long)st->tx_calls,
+            st->tx_calls ? (double)st->tx_datagrams / st->tx_calls : 0.0,
+            (unsigned long long)st->rx_datagrams, (unsigned long long)st->rx_calls,
+            st->rx_calls ? (double)st->rx_datagrams / st->rx_calls : 0.0);
+}
@@ -0,0 +1,200 @@
+/*
+@file batch_io.h
+@brief batched UDP send and receive with sendmmsg/recvmmsg
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef BATCH_IO_H
+#define BATCH_IO_H
+
+// struct mmsghdr needs _GNU_SOURCE defined before the first system header
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define BATCH_SIZE 32       // default datagrams per syscall
+#define MAX_BATCH_SIZE 1024 // UIO_MAXIOV, the kernel's limit for one call
+#define GSO_MAX_SEGMENTS 64 // UDP_MAX_SEGMENTS on older kernels
+#define GSO_MAX_BYTES 65000 // a super-buffer still has to fit one IP datagram
+#define GRO_BUFFER_SIZE 65536
+#define BATCH_MAX_IOV 2     // pieces a queued datagram may be gathered from
+
+/*
+@brief syscall and datagram counters, to see how well batching works
+
+datagrams are counted as they are on the wire, a GSO or GRO
+super-buffer counts once per segment
+*/
+struct batch_stats {
+    uint64_t tx_calls;
+    uint64_t tx_datagrams;
+    uint64_t rx_calls;
+    uint64_t rx_datagrams;
+};
+
+/*
+@brief one received datagram, possibly cut out of a GRO super-buffer
+*/
+struct batch_segment {
+    char *data;
+    size_t len;
+    int msg;                    // the message it arrived in, for the address
+};
+
+/*
+@brief queues of outgoing and incoming datagrams for one socket
+
+Outgoing datagrams are queued until batch_io_flush() hands them to the
+kernel in one sendmmsg call. Queued data is referenced, not copied,
+unless the caller asks for a copy, so it must stay valid until the
+flush. A datagram may be gathered from a few separate pieces, such as a
+header and a payload that live apart. Incoming datagrams are drained
+into a preallocated slab by batch_io_recv() and read back with
+batch_io_datagram().
+
+With GSO, runs of equally sized datagrams to the same address leave
+as one super-buffer that the kernel segments. With GRO, the kernel may
+hand back such a super-buffer, batch_io_recv() splits it again.
+*/
+struct batch_io {
+    int sockfd;
+    int size;
+    size_t max_datagram;
+    int gso;                    // 1 while sends are coalesced with UDP_SEGMENT
+    int gro;                    // 1 once UDP_GRO is enabled on the socket
+
+    struct mmsghdr *tx_msgs;
+    struct iovec *tx_iovs;      // the queued datagrams' pieces, in queue order
+    int *tx_first_iov;          // each datagram's first piece, plus one past the last
+    size_t *tx_lens;            // each datagram's length
+    struct sockaddr_in *tx_addrs;
+    int *tx_segments;           // datagrams carried by each message
+    char *tx_control;           // a UDP_SEGMENT cmsg per message
+    char *tx_copies;            // size * max_datagram bytes for copied datagrams
+    int tx_count;
+
+    struct mmsghdr *rx_msgs;
+    struct iovec *rx_iovs;
+    struct sockaddr_in *rx_addrs;
+    char *rx_control;           // a UDP_GRO cmsg per message
+    char *rx_bufs;              // size * rx_buf_size bytes
+    size_t rx_buf_size;
+    struct batch_segment *rx_segs;
+    int rx_segs_capacity;
+    int rx_count;
+
+    struct batch_stats stats;
+};
+
+/*
+@brief allocates the queues
+
+@param io: the batch to initialize
+@param sockfd: the socket to send and receive on
+@param size: the most datagrams per syscall, 1 to MAX_BATCH_SIZE
+@param max_datagram: the largest datagram sent or received
+
+@return 0 in case of failure, 1 in case of success
+*/
+int batch_io_init(struct batch_io *io, int sockfd, int size, size_t max_datagram);
+
+/*
+@brief releases the queues
+
+@param io: the batch
+*/
+void batch_io_free(struct batch_io *io);
+
+/*
+@brief turns on UDP generic segmentation offload for sends, if the kernel has it
+
+@param io: the batch
+
+@return 1 if enabled, 0 if the kernel doesn't support it and sends stay one datagram each
+*/
+int batch_io_enable_gso(struct batch_io *io);
+
+/*
+@brief turns on UDP generic receive offload, if the kernel has it
+
+@param io: the batch
+
+@return 1 if enabled, 0 if unsupported or the larger buffers couldn't be allocated
+*/
+int batch_io_enable_gro(struct batch_io *io);
+
+/*
+@brief queues a datagram, flushing first if the queue is full
+
+@param io: the batch
+@param data: the datagram
+@param len: its length
+@param to: the destination address
+@param copy: 1 to copy data into the batch, 0 to reference it until the flush
+
+@return 0 in case of failure, 1 in case of success
+*/
+int batch_io_queue(struct batch_io *io, const void *data, size_t len, const struct sockaddr_in *to, int copy);
+
+/*
+@brief queues a datagram gathered from separate pieces, flushing first if the queue is full
+
+the pieces are referenced, not copied, so they must stay valid until the flush
+
+@param io: the batch
+@param iov: the pieces, in order
+@param iovcnt: how many, 1 to BATCH_MAX_IOV
+@param to: the destination address
+
+@return 0 in case of failure, 1 in case of success
+*/
+int batch_io_queue_iov(struct batch_io *io, const struct iovec *iov, int iovcnt, const struct sockaddr_in *to);
+
+/*
+@brief sends every queued datagram
+
+if the kernel rejects a GSO send, GSO is switched off and the rest of
+the queue goes out one datagram per message
+
+@param io: the batch
+
+@return 0 in case of failure, 1 in case of success
+*/
+int batch_io_flush(struct batch_io *io);
+
+/*
+@brief receives up to a batch of messages in one call
+
+@param io: the batch
+@param flags: recvmmsg flags, MSG_DONTWAIT to poll or MSG_WAITFORONE to block for the first
+
+@return the number of datagrams received, 0 if none were waiting, -1 on error
+*/
+int batch_io_recv(struct batch_io *io, int flags);
+
+/*
+@brief reads back a datagram from the last batch_io_recv()
+
+@param io: the batch
+@param i: which datagram, below the count returned by batch_io_recv()
+@param len: where to store its length
+@param from: where to store the sender's address, may be NULL
+
+@return the datagram's bytes
+*/
+char *batch_io_datagram(struct batch_io *io, int i, size_t *len, struct sockaddr_in *from);
+
+/*
+@brief prints the batch size and the average datagrams per syscall
+
+@param io: the batch
+@param out: where to print
+*/
+void batch_io_print_stats(const struct batch_io *io, FILE *out);
+
+#endif
@@ -0,0 +1,52 @@
+/*
+@file clock.h
+@brief monotonic time helpers shared by the sender and receiver
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+@brief reads the monotonic clock
+
+@return the current monotonic time in microseconds
+*/
+static inline uint64_t monotonic_us(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/*
+@brief reads the monotonic clock
+
+@return the current monotonic time in nanoseconds
+*/
+static inline uint64_t monotonic_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+@brief sleeps until a point on the monotonic clock, resuming after signals
+
+@param deadline_ns: when to wake up, in monotonic nanoseconds
+*/
+static inline void sleep_until_ns(uint64_t deadline_ns){
+    struct timespec ts;
+    ts.tv_sec = deadline_ns / 1000000000ULL;
+    ts.tv_nsec = deadline_ns % 1000000000ULL;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR){
+    }
+}
+
+#endif
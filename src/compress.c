@@ -0,0 +1,278 @@
+/*
+@file compress.c
+@brief LZ compression of the data in blocks, so text and logs take fewer packets
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "compress.h"
+
+#define MIN_MATCH 4
+#define LAST_LITERALS 5     // the block ends in literals, as the LZ4 format asks
+#define MATCH_LIMIT 12      // no match starts this close to the end
+#define MAX_OFFSET 65535
+
+/*
+@brief reads 4 bytes wherever they are
+*/
+static uint32_t read32(const char *p){
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/*
+@brief the hash table slot for 4 bytes
+*/
+static uint32_t hash4(uint32_t v){
+    return (v * 2654435761u) >> (32 - COMPRESS_HASH_BITS);
+}
+
+/*
+@brief writes the 255 bytes and remainder of a length that overflowed its 4 bit field
+
+@param op: where to write
+@param len: the length minus the 15 the field held
+*/
+static char *put_length(char *op, size_t len){
+    for(; len >= 255; len -= 255) *op++ = (char)255;
+    *op++ = (char)len;
+    return op;
+}
+
+/*
+@brief writes one sequence: a token, the literals, then the match if there is one
+
+@param op: where to write
+@param literals: the literals
+@param lit: how many
+@param offset: how far back the match is, 0 for the final literals only sequence
+@param match: the match's length minus MIN_MATCH
+*/
+static char *put_sequence(char *op, const char *literals, size_t lit, size_t offset, size_t match){
+    char *token = op++;
+    *token = (char)((lit >= 15 ? 15 : lit) << 4);
+    if(lit >= 15) op = put_length(op, lit - 15);
+    memcpy(op, literals, lit);
+    op += lit;
+    if(offset == 0) return op;
+    *op++ = (char)(offset & 0xff);
+    *op++ = (char)(offset >> 8);
+    *token |= (char)(match >= 15 ? 15 : match);
+    if(match >= 15) op = put_length(op, match - 15);
+    return op;
+}
+
+size_t lz_compress(uint32_t *table, const char *src, size_t len, char *dst, size_t cap){
+    const char *ip = src;
+    const char *anchor = src;
+    const char *end = src + len;
+    char *op = dst;
+    char *op_end = dst + cap;
+
+    if(len > MATCH_LIMIT){
+        const char *limit = end - MATCH_LIMIT;
+        const char *match_end = end - LAST_LITERALS;
+        memset(table, 0, sizeof(*table) << COMPRESS_HASH_BITS);
+        ip++;
+        while(ip < limit){
+            uint32_t h = hash4(read32(ip));
+            const char *ref = src + table[h];
+            table[h] = ip - src;
+            if(ref >= ip || ip - ref > MAX_OFFSET || read32(ref) != read32(ip)){
+                ip++;
+                continue;
+            }
+            // grow the match both ways
+            while(ip > anchor && ref > src && ip[-1] == ref[-1]){
+                ip--;
+                ref--;
+            }
+            const char *mp = ip + MIN_MATCH;
+            const char *rp = ref + MIN_MATCH;
+            while(mp < match_end && *mp == *rp){
+                mp++;
+                rp++;
+            }
+            size_t lit = ip - anchor;
+            size_t match = mp - ip - MIN_MATCH;
+            // the worst case for this sequence, so nothing is written past cap
+            if((size_t)(op_end - op) < 1 + lit + lit / 255 + 1 + 2 + match / 255 + 1) return 0;
+            op = put_sequence(op, anchor, lit, ip - ref, match);
+            ip = mp;
+            anchor = ip;
+            if(ip - 2 > src && ip < limit) table[hash4(read32(ip - 2))] = ip - 2 - src;
+        }
+    }
+    size_t lit = end - anchor;
+    if((size_t)(op_end - op) < 1 + lit + lit / 255 + 1) return 0;
+    op = put_sequence(op, anchor, lit, 0, 0);
+    return op - dst;
+}
+
+/*
+@brief reads the 255 bytes and remainder of a length that overflowed its 4 bit field
+
+@param ip: where they start, moved past them
+@param end: the end of the data
+@param len: the length to add them to
+
+@return 0 if the data ends first, 1 otherwise
+*/
+static int get_length(const unsigned char **ip, const unsigned char *end, size_t *len){
+    unsigned char b;
+    do {
+        if(*ip >= end) return 0;
+        b = *(*ip)++;
+        *len += b;
+    } while(b == 255);
+    return 1;
+}
+
+long lz_decompress(const char *src, size_t len, char *dst, size_t cap){
+    const unsigned char *ip = (const unsigned char *)src;
+    const unsigned char *end = ip + len;
+    char *op = dst;
+    char *op_end = dst + cap;
+    while(ip < end){
+        unsigned token = *ip++;
+        size_t lit = token >> 4;
+        if(lit == 15 && get_length(&ip, end, &lit) == 0) return -1;
+        if((size_t)(end - ip) < lit || (size_t)(op_end - op) < lit) return -1;
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        // the final sequence is literals only
+        if(ip == end) break;
+
+        if(end - ip < 2) return -1;
+        size_t offset = ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        size_t match = token & 15;
+        if(match == 15 && get_length(&ip, end, &match) == 0) return -1;
+        match += MIN_MATCH;
+        if(offset == 0 || offset > (size_t)(op - dst) || (size_t)(op_end - op) < match) return -1;
+        const char *ref = op - offset;
+        if(offset >= match){
+            memcpy(op, ref, match);
+        } else {
+            // the match overlaps what it copies, a run: byte by byte
+            for(size_t i = 0; i < match; i++) op[i] = ref[i];
+        }
+        op += match;
+    }
+    return op - dst;
+}
+
+int compressor_init(struct compressor *c, int needs_raw){
+    memset(c, 0, sizeof(*c));
+    c->frame = malloc(sizeof(struct block_header) + COMPRESS_BLOCK);
+    c->table = malloc(sizeof(*c->table) << COMPRESS_HASH_BITS);
+    if(needs_raw) c->raw = malloc(COMPRESS_BLOCK);
+    if(c->frame == NULL || c->table == NULL || (needs_raw && c->raw == NULL)){
+        compressor_free(c);
+        return 0;
+    }
+    c->backoff = 1;
+    return 1;
+}
+
+void compressor_free(struct compressor *c){
+    free(c->raw);
+    free(c->frame);
+    free(c->table);
+    c->raw = NULL;
+    c->frame = NULL;
+    c->table = NULL;
+}
+
+void compressor_pack(struct compressor *c, const char *data, size_t len){
+    struct block_header hdr;
+    char *out = c->frame + sizeof(hdr);
+    size_t stored = 0;
+    if(c->skip > 0){
+        c->skip--;
+    } else {
+        // only worth it if it saves more than the header costs
+        size_t overhead = sizeof(hdr) + len / 64;
+        if(len > overhead) stored = lz_compress(c->table, data, len, out, len - overhead);
+        if(stored == 0){
+            c->skip = c->backoff;
+            if(c->backoff < COMPRESS_MAX_SKIP) c->backoff *= 2;
+        } else {
+            c->backoff = 1;
+        }
+    }
+    if(stored == 0){
+        memcpy(out, data, len);
+        stored = len;
+        c->stored++;
+    }
+    hdr.raw_len = len;
+    hdr.stored_len = stored;
+    memcpy(c->frame, &hdr, sizeof(hdr));
+    c->len = sizeof(hdr) + stored;
+    c->sent = 0;
+    c->raw_bytes += len;
+    c->wire_bytes += c->len;
+    c->blocks++;
+}
+
+int decompressor_init(struct decompressor *d){
+    memset(d, 0, sizeof(*d));
+    d->frame = malloc(sizeof(struct block_header) + COMPRESS_BLOCK);
+    d->raw = malloc(COMPRESS_BLOCK);
+    if(d->frame == NULL || d->raw == NULL){
+        decompressor_free(d);
+        return 0;
+    }
+    return 1;
+}
+
+void decompressor_free(struct decompressor *d){
+    free(d->frame);
+    free(d->raw);
+    d->frame = NULL;
+    d->raw = NULL;
+}
+
+int decompressor_feed(struct decompressor *d, const char *data, size_t len,
+                      int (*emit)(void *ctx, const char *raw, size_t len), void *ctx){
+    struct block_header hdr;
+    while(len > 0){
+        // the header first, then as much of the block as it says
+        size_t want = sizeof(hdr);
+        if(d->have >= sizeof(hdr)){
+            memcpy(&hdr, d->frame, sizeof(hdr));
+            want += hdr.stored_len;
+        }
+        size_t take = want - d->have < len ? want - d->have : len;
+        memcpy(d->frame + d->have, data, take);
+        d->have += take;
+        data += take;
+        len -= take;
+        if(d->have < want) continue;
+
+        if(want == sizeof(hdr)){
+            memcpy(&hdr, d->frame, sizeof(hdr));
+            if(hdr.raw_len < 1 || hdr.raw_len > COMPRESS_BLOCK || hdr.stored_len < 1 || hdr.stored_len > hdr.raw_len){
+                return 0;
+            }
+            continue;
+        }
+        const char *raw = d->frame + sizeof(hdr);
+        if(hdr.stored_len < hdr.raw_len){
+            if(lz_decompress(raw, hdr.stored_len, d->raw, COMPRESS_BLOCK) != hdr.raw_len) return 0;
+            raw = d->raw;
+        }
+        d->have = 0;
+        d->blocks++;
+        if(emit(ctx, raw, hdr.raw_len) == 0) return 0;
+    }
+    return 1;
+}
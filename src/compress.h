@@ -0,0 +1,135 @@
+/*
+@file compress.h
+@brief LZ compression of the data in blocks, so text and logs take fewer packets
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+#define COMPRESS_BLOCK 65536        // raw bytes per block, every match offset fits in 16 bits
+#define COMPRESS_HASH_BITS 14
+#define COMPRESS_MAX_SKIP 16        // most blocks stored without trying after a block didn't compress
+
+/*
+@brief the sender's side: turns raw blocks into the stream of struct block_header framed blocks
+
+frame holds one framed block at a time, the data packets are cut from
+it. A block that doesn't shrink is stored as is, and each one in a row
+doubles how many blocks are then stored without trying, so data that
+doesn't compress costs little CPU.
+*/
+struct compressor {
+    char *raw;                      // a block read from a source that isn't in memory
+    char *frame;                    // the framed block being sent
+    size_t len;                     // its length
+    size_t sent;                    // how much of it is in packets already
+    uint32_t *table;                // the match finder's hash table
+    int skip;                       // blocks left to store without trying
+    int backoff;                    // the skip after the next block that doesn't compress
+    unsigned long long raw_bytes;
+    unsigned long long wire_bytes;  // framed, headers included
+    unsigned long long blocks;
+    unsigned long long stored;      // blocks sent as is
+};
+
+/*
+@brief the receiver's side: reassembles the framed blocks from in order data and expands them
+*/
+struct decompressor {
+    char *frame;                    // the block being reassembled, header included
+    size_t have;
+    char *raw;                      // its expanded data
+    unsigned long long blocks;
+};
+
+/*
+@brief compresses one buffer in the LZ4 block format
+
+@param table: a hash table of 1 << COMPRESS_HASH_BITS entries, its contents don't matter
+@param src: the data, at most COMPRESS_BLOCK bytes
+@param len: its length
+@param dst: where to write the compressed data
+@param cap: the most bytes to write
+
+@return the compressed length, 0 if it doesn't fit in cap
+*/
+size_t lz_compress(uint32_t *table, const char *src, size_t len, char *dst, size_t cap);
+
+/*
+@brief expands data lz_compress() made, checking every length and offset against the buffers
+
+@param src: the compressed data
+@param len: its length
+@param dst: where to write the data
+@param cap: the room there
+
+@return the expanded length, -1 if the data is corrupt or doesn't fit
+*/
+long lz_decompress(const char *src, size_t len, char *dst, size_t cap);
+
+/*
+@brief allocates a compressor
+
+@param c: the compressor to initialize
+@param needs_raw: 1 if blocks are read into c->raw, 0 if the data is in memory
+
+@return 0 in case of failure, 1 in case of success
+*/
+int compressor_init(struct compressor *c, int needs_raw);
+
+/*
+@brief releases a compressor's buffers, its counters stay
+
+@param c: the compressor
+*/
+void compressor_free(struct compressor *c);
+
+/*
+@brief frames the next block into c->frame, compressed if that makes it smaller
+
+@param c: the compressor
+@param data: the block's raw data
+@param len: its length, 1 to COMPRESS_BLOCK
+*/
+void compressor_pack(struct compressor *c, const char *data, size_t len);
+
+/*
+@brief allocates a decompressor
+
+@param d: the decompressor to initialize
+
+@return 0 in case of failure, 1 in case of success
+*/
+int decompressor_init(struct decompressor *d);
+
+/*
+@brief releases a decompressor
+
+@param d: the decompressor
+*/
+void decompressor_free(struct decompressor *d);
+
+/*
+@brief takes the next in order bytes of the stream and hands over every block they complete
+
+@param d: the decompressor
+@param data: the bytes
+@param len: how many
+@param emit: called with each block's raw data, returns 0 to stop
+@param ctx: passed to emit
+
+@return 0 if a block is corrupt or emit refused one, 1 otherwise
+*/
+int decompressor_feed(struct decompressor *d, const char *data, size_t len,
+                      int (*emit)(void *ctx, const char *raw, size_t len), void *ctx);
+
+#endif
@@ -0,0 +1,265 @@
+/*
+@file congestion.c
+@brief pluggable congestion control for the sender (Reno, CUBIC and a BBR-style model)
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "congestion.h"
+
+#define CUBIC_C 0.4
+#define CUBIC_BETA 0.7
+#define MIN_RTT_WINDOW_US 10000000ULL  // BBR refreshes its min RTT every 10s
+#define PROBE_RTT_US 200000ULL
+#define BBR_HIGH_GAIN 2.885            // 2/ln(2), doubles the rate every round
+#define BBR_PROBE_RTT_CWND 4
+
+static const double bbr_cycle_gains[] = {1.25, 0.75, 1, 1, 1, 1, 1, 1};
+
+int cc_parse(const char *name, enum cc_algorithm *algo){
+    if(strcmp(name, "reno") == 0) *algo = CC_RENO;
+    else if(strcmp(name, "cubic") == 0) *algo = CC_CUBIC;
+    else if(strcmp(name, "bbr") == 0) *algo = CC_BBR;
+    else return 0;
+    return 1;
+}
+
+void cc_init(struct congestion *cc, enum cc_algorithm algo, double max_cwnd){
+    memset(cc, 0, sizeof(*cc));
+    cc->algo = algo;
+    cc->max_cwnd = max_cwnd < 1 ? 1 : max_cwnd;
+    cc->cwnd = CC_INIT_CWND < cc->max_cwnd ? CC_INIT_CWND : cc->max_cwnd;
+    cc->ssthresh = cc->max_cwnd;
+    cc->mode = BBR_STARTUP;
+    cc->pacing_gain = BBR_HIGH_GAIN;
+    cc->cwnd_gain = BBR_HIGH_GAIN;
+}
+
+void cc_on_send(struct congestion *cc, struct cc_packet_state *state, uint64_t now_us){
+    if(cc->delivered_us == 0) cc->delivered_us = now_us;
+    state->sent_us = now_us;
+    state->delivered = cc->delivered;
+    state->delivered_us = cc->delivered_us;
+}
+
+/*
+@brief the bottleneck bandwidth estimate, max over the last CC_BW_WINDOW rounds
+
+@param cc: the controller
+
+@return packets per second
+*/
+static double bbr_btl_bw(const struct congestion *cc){
+    double bw = 0;
+    for(int i = 0; i < CC_BW_WINDOW; i++){
+        if(cc->bw_samples[i] > bw) bw = cc->bw_samples[i];
+    }
+    return bw;
+}
+
+/*
+@brief the estimated bandwidth delay product
+
+@param cc: the controller
+
+@return packets, 0 if there is no estimate yet
+*/
+static double bbr_bdp(const struct congestion *cc){
+    return bbr_btl_bw(cc) * (double)cc->min_rtt_us / 1e6;
+}
+
+/*
+@brief the BBR-style update: bandwidth filter, state machine, cwnd target
+
+@param cc: the controller
+@param state: the snapshot of the acknowledged packet
+@param now_us: the current monotonic time
+@param round_start: whether this ack started a new round trip
+@param min_rtt_expired: whether the min RTT sample is older than its window
+*/
+static void bbr_on_ack(struct congestion *cc, const struct cc_packet_state *state, uint64_t now_us,
+                       int round_start, int min_rtt_expired){
+    // delivery rate sample over the interval this packet was in flight
+    uint64_t interval = now_us - state->delivered_us;
+    if(interval > 0){
+        double rate = (double)(cc->delivered - state->delivered) * 1e6 / (double)interval;
+        int slot = cc->round % CC_BW_WINDOW;
+        if(round_start) cc->bw_samples[slot] = rate;
+        else if(rate > cc->bw_samples[slot]) cc->bw_samples[slot] = rate;
+    }
+
+    double btl_bw = bbr_btl_bw(cc);
+    if(round_start && !cc->filled_pipe){
+        if(btl_bw >= cc->full_bw * 1.25){
+            cc->full_bw = btl_bw;
+            cc->full_bw_rounds = 0;
+        } else if(++cc->full_bw_rounds >= 3){
+            cc->filled_pipe = 1;
+        }
+    }
+
+    switch(cc->mode){
+        case BBR_STARTUP:
+            if(cc->filled_pipe){
+                cc->mode = BBR_DRAIN;
+                cc->pacing_gain = 1 / BBR_HIGH_GAIN;
+                cc->cwnd_gain = BBR_HIGH_GAIN;
+            }
+            break;
+        case BBR_DRAIN:
+            if(round_start){
+                cc->mode = BBR_PROBE_BW;
+                cc->cycle_idx = 0;
+                cc->cycle_stamp_us = now_us;
+                cc->pacing_gain = bbr_cycle_gains[0];
+                cc->cwnd_gain = 2;
+            }
+            break;
+        case BBR_PROBE_BW:
+            if(now_us - cc->cycle_stamp_us > cc->min_rtt_us){
+                cc->cycle_idx = (cc->cycle_idx + 1) % (int)(sizeof(bbr_cycle_gains) / sizeof(bbr_cycle_gains[0]));
+                cc->cycle_stamp_us = now_us;
+                cc->pacing_gain = bbr_cycle_gains[cc->cycle_idx];
+            }
+            break;
+        case BBR_PROBE_RTT:
+            if(now_us >= cc->probe_rtt_done_us){
+                cc->min_rtt_stamp_us = now_us;
+                cc->mode = cc->filled_pipe ? BBR_PROBE_BW : BBR_STARTUP;
+                cc->pacing_gain = cc->filled_pipe ? 1 : BBR_HIGH_GAIN;
+                cc->cwnd_gain = cc->filled_pipe ? 2 : BBR_HIGH_GAIN;
+                cc->cycle_stamp_us = now_us;
+            }
+            break;
+    }
+    if(min_rtt_expired && cc->mode != BBR_PROBE_RTT){
+        cc->mode = BBR_PROBE_RTT;
+        cc->pacing_gain = 1;
+        cc->probe_rtt_done_us = now_us + PROBE_RTT_US;
+    }
+
+    // grow toward gain * BDP, with a few packets of slack for ack aggregation
+    double target = cc->cwnd_gain * bbr_bdp(cc) + 3;
+    if(cc->filled_pipe){
+        cc->cwnd = cc->cwnd + 1 < target ? cc->cwnd + 1 : target;
+    } else if(cc->cwnd < target || cc->delivered < CC_INIT_CWND){
+        cc->cwnd += 1;
+    }
+    if(cc->mode == BBR_PROBE_RTT && cc->cwnd > BBR_PROBE_RTT_CWND) cc->cwnd = BBR_PROBE_RTT_CWND;
+}
+
+/*
+@brief the CUBIC congestion avoidance update (RFC 8312)
+
+@param cc: the controller
+@param now_us: the current monotonic time
+*/
+static void cubic_on_ack(struct congestion *cc, uint64_t now_us){
+    if(cc->epoch_us == 0){
+        cc->epoch_us = now_us;
+        cc->w_est = cc->cwnd;
+        if(cc->cwnd < cc->w_max){
+            cc->k = cbrt((cc->w_max - cc->cwnd) / CUBIC_C);
+            cc->origin = cc->w_max;
+        } else {
+            cc->k = 0;
+            cc->origin = cc->cwnd;
+        }
+    }
+    double t = (double)(now_us - cc->epoch_us + cc->min_rtt_us) / 1e6;
+    double target = cc->origin + CUBIC_C * pow(t - cc->k, 3);
+    if(target > cc->cwnd * 1.5) target = cc->cwnd * 1.5;
+    if(target > cc->cwnd) cc->cwnd += (target - cc->cwnd) / cc->cwnd;
+    else cc->cwnd += 0.01 / cc->cwnd;
+
+    // stay at least as aggressive as Reno would be
+    cc->w_est += 3 * (1 - CUBIC_BETA) / (1 + CUBIC_BETA) / cc->cwnd;
+    if(cc->w_est > cc->cwnd) cc->cwnd = cc->w_est;
+}
+
+void cc_on_ack(struct congestion *cc, long long seq, const struct cc_packet_state *state, uint64_t now_us, int retransmitted){
+    cc->delivered++;
+    cc->delivered_us = now_us;
+
+    int min_rtt_expired = cc->min_rtt_us != 0 && now_us - cc->min_rtt_stamp_us > MIN_RTT_WINDOW_US;
+    if(!retransmitted && now_us > state->sent_us){
+        uint64_t rtt = now_us - state->sent_us;
+        if(cc->min_rtt_us == 0 || rtt <= cc->min_rtt_us || min_rtt_expired){
+            cc->min_rtt_us = rtt;
+            cc->min_rtt_stamp_us = now_us;
+        }
+    }
+
+    int round_start = 0;
+    if(state->delivered >= cc->next_round_delivered){
+        cc->next_round_delivered = cc->delivered;
+        cc->round++;
+        round_start = 1;
+    }
+
+    if(cc->in_recovery && seq >= cc->recovery_end) cc->in_recovery = 0;
+
+    if(cc->algo == CC_BBR){
+        bbr_on_ack(cc, state, now_us, round_start, min_rtt_expired);
+    } else if(!cc->in_recovery){
+        if(cc->cwnd < cc->ssthresh) cc->cwnd += 1;
+        else if(cc->algo == CC_CUBIC) cubic_on_ack(cc, now_us);
+        else cc->cwnd += 1 / cc->cwnd;
+    }
+
+    if(cc->cwnd > cc->max_cwnd) cc->cwnd = cc->max_cwnd;
+    if(cc->cwnd < 1) cc->cwnd = 1;
+}
+
+void cc_on_loss(struct congestion *cc, long long lost_seq, long long next_seq){
+    if(cc->in_recovery && lost_seq < cc->recovery_end) return;
+    cc->in_recovery = 1;
+    cc->recovery_end = next_seq;
+
+    switch(cc->algo){
+        case CC_RENO:
+            cc->ssthresh = cc->cwnd / 2 > 2 ? cc->cwnd / 2 : 2;
+            cc->cwnd = cc->ssthresh;
+            break;
+        case CC_CUBIC:
+            // fast convergence: release bandwidth if the last peak was not reached
+            if(cc->cwnd < cc->w_max) cc->w_max = cc->cwnd * (1 + CUBIC_BETA) / 2;
+            else cc->w_max = cc->cwnd;
+            cc->cwnd = cc->cwnd * CUBIC_BETA > 2 ? cc->cwnd * CUBIC_BETA : 2;
+            cc->ssthresh = cc->cwnd;
+            cc->epoch_us = 0;
+            break;
+        case CC_BBR:
+            // the model, not loss, sets the window; just stop growing for this flight
+            break;
+    }
+}
+
+void cc_on_timeout(struct congestion *cc){
+    if(cc->algo != CC_BBR){
+        cc->ssthresh = cc->cwnd / 2 > 2 ? cc->cwnd / 2 : 2;
+        if(cc->algo == CC_CUBIC){
+            cc->w_max = cc->cwnd;
+            cc->epoch_us = 0;
+        }
+    }
+    cc->cwnd = 1;
+    cc->in_recovery = 0;
+}
+
+int cc_window(const struct congestion *cc){
+    int window = (int)cc->cwnd;
+    if(window < 1) window = 1;
+    if(window > cc->max_cwnd) window = (int)cc->max_cwnd;
+    return window;
+}
+
+double cc_pacing_rate(const struct congestion *cc){
+    if(cc->algo != CC_BBR) return 0;
+    return cc->pacing_gain * bbr_btl_bw(cc);
+}
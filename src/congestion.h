@@ -0,0 +1,164 @@
+/*
+@file congestion.h
+@brief pluggable congestion control for the sender (Reno, CUBIC and a BBR-style model)
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef CONGESTION_H
+#define CONGESTION_H
+
+#include <stdint.h>
+
+#define CC_DUP_THRESH 3     // acks for later packets before a hole counts as lost
+#define CC_BW_WINDOW 10     // rounds kept in the BBR bandwidth filter
+#define CC_INIT_CWND 10     // initial window in packets, as in RFC 6928
+
+/*
+@brief the available congestion control algorithms
+*/
+enum cc_algorithm {
+    CC_RENO,
+    CC_CUBIC,
+    CC_BBR
+};
+
+/*
+@brief BBR-style controller phases
+*/
+enum bbr_mode {
+    BBR_STARTUP,
+    BBR_DRAIN,
+    BBR_PROBE_BW,
+    BBR_PROBE_RTT
+};
+
+/*
+@brief per packet snapshot taken at send time, used for rate and round sampling
+*/
+struct cc_packet_state {
+    uint64_t sent_us;
+    uint64_t delivered;
+    uint64_t delivered_us;
+};
+
+/*
+@brief congestion controller state, windows are counted in packets
+*/
+struct congestion {
+    enum cc_algorithm algo;
+    double cwnd;
+    double ssthresh;
+    double max_cwnd;
+
+    // loss recovery, one window reduction per flight
+    int in_recovery;
+    long long recovery_end;
+
+    // delivery accounting, shared by every algorithm
+    uint64_t delivered;
+    uint64_t delivered_us;
+    uint64_t round;
+    uint64_t next_round_delivered;
+    uint64_t min_rtt_us;
+    uint64_t min_rtt_stamp_us;
+
+    // CUBIC
+    double w_max;
+    double w_est;
+    double k;
+    double origin;
+    uint64_t epoch_us;
+
+    // BBR-style model
+    enum bbr_mode mode;
+    double bw_samples[CC_BW_WINDOW];    // packets per second, max of each round
+    double full_bw;
+    int full_bw_rounds;
+    int filled_pipe;
+    int cycle_idx;
+    uint64_t cycle_stamp_us;
+    uint64_t probe_rtt_done_us;
+    double pacing_gain;
+    double cwnd_gain;
+};
+
+/*
+@brief parses an algorithm name given on the command line
+
+@param name: "reno", "cubic" or "bbr"
+@param algo: where to store the parsed algorithm
+
+@return 0 in case of failure, 1 in case of success
+*/
+int cc_parse(const char *name, enum cc_algorithm *algo);
+
+/*
+@brief initializes a controller in slow start with the initial window
+
+@param cc: the controller
+@param algo: the algorithm to run
+@param max_cwnd: hard cap on the window, e.g. the sender's window storage
+*/
+void cc_init(struct congestion *cc, enum cc_algorithm algo, double max_cwnd);
+
+/*
+@brief records delivery state into a packet as it is (re)sent
+
+@param cc: the controller
+@param state: the packet's snapshot to fill
+@param now_us: the current monotonic time
+*/
+void cc_on_send(struct congestion *cc, struct cc_packet_state *state, uint64_t now_us);
+
+/*
+@brief grows the window for a newly acknowledged packet
+
+@param cc: the controller
+@param seq: sequence number of the acknowledged packet
+@param state: the snapshot taken when the packet was last sent
+@param now_us: the current monotonic time
+@param retransmitted: whether the packet was ever resent, such packets give no RTT sample
+*/
+void cc_on_ack(struct congestion *cc, long long seq, const struct cc_packet_state *state, uint64_t now_us, int retransmitted);
+
+/*
+@brief reacts to a packet detected lost by fast retransmit
+
+Only the first loss in a flight shrinks the window; losses of packets
+sent before the recovery point are part of the same congestion event.
+
+@param cc: the controller
+@param lost_seq: sequence number of the lost packet
+@param next_seq: the next sequence number to be sent, marks the end of recovery
+*/
+void cc_on_loss(struct congestion *cc, long long lost_seq, long long next_seq);
+
+/*
+@brief collapses the window after a retransmission timeout
+
+@param cc: the controller
+*/
+void cc_on_timeout(struct congestion *cc);
+
+/*
+@brief the number of packets the sender may have in flight
+
+@param cc: the controller
+
+@return the current window, at least one packet
+*/
+int cc_window(const struct congestion *cc);
+
+/*
+@brief the controller's preferred sending rate
+
+@param cc: the controller
+
+@return packets per second, or 0 when the algorithm has no rate estimate yet
+*/
+double cc_pacing_rate(const struct congestion *cc);
+
+#endif
@@ -0,0 +1,200 @@
+/*
+@file crc32c.c
+@brief CRC32C (Castagnoli) checksums of packets, and of a whole transfer built from them
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "crc32c.h"
+
+#define POLY 0x82F63B78u    // the Castagnoli polynomial, bit reversed
+
+static uint32_t slices[8][256];
+
+/*
+@brief fills the tables for eight bytes at a time
+*/
+static void make_slices(void){
+    for(int i = 0; i < 256; i++){
+        uint32_t c = i;
+        for(int bit = 0; bit < 8; bit++) c = c & 1 ? (c >> 1) ^ POLY : c >> 1;
+        slices[0][i] = c;
+    }
+    for(int i = 0; i < 256; i++){
+        for(int k = 1; k < 8; k++) slices[k][i] = (slices[k - 1][i] >> 8) ^ slices[0][slices[k - 1][i] & 0xff];
+    }
+}
+
+/*
+@brief the portable CRC, eight bytes per step through eight tables
+
+@param c: the CRC register, inverted
+@param p: the data
+@param len: its length
+
+@return the register after the data
+*/
+static uint32_t crc_table(uint32_t c, const unsigned char *p, size_t len){
+    for(; len >= 8; len -= 8, p += 8){
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= c;
+        c = slices[7][lo & 0xff] ^ slices[6][(lo >> 8) & 0xff] ^ slices[5][(lo >> 16) & 0xff] ^ slices[4][lo >> 24] ^
+            slices[3][hi & 0xff] ^ slices[2][(hi >> 8) & 0xff] ^ slices[1][(hi >> 16) & 0xff] ^ slices[0][hi >> 24];
+    }
+    for(; len > 0; len--, p++) c = (c >> 8) ^ slices[0][(c ^ *p) & 0xff];
+    return c;
+}
+
+#if defined(__x86_64__)
+/*
+@brief the CRC with the SSE4.2 crc32 instruction, built for it whatever the compiler flags and only called where the CPU has it
+
+@param c: the CRC register, inverted
+@param p: the data
+@param len: its length
+
+@return the register after the data
+*/
+__attribute__((target("sse4.2"))) static uint32_t crc_sse42(uint32_t c, const unsigned char *p, size_t len){
+    uint64_t c64 = c;
+    for(; len >= 8; len -= 8, p += 8){
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c64 = _mm_crc32_u64(c64, v);
+    }
+    c = (uint32_t)c64;
+    for(; len > 0; len--, p++) c = _mm_crc32_u8(c, *p);
+    return c;
+}
+#endif
+
+static uint32_t (*crc_impl)(uint32_t c, const unsigned char *p, size_t len);
+static const char *crc_impl_name;
+
+/*
+@brief picks the fastest CRC this CPU runs, once
+*/
+static void pick_crc(void){
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("sse4.2")){
+        crc_impl_name = "sse4.2";
+        crc_impl = crc_sse42;
+        return;
+    }
+#endif
+    make_slices();
+    crc_impl_name = "table";
+    crc_impl = crc_table;
+}
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t len){
+    if(crc_impl == NULL) pick_crc();
+    return ~crc_impl(~crc, data, len);
+}
+
+const char *crc32c_name(void){
+    if(crc_impl == NULL) pick_crc();
+    return crc_impl_name;
+}
+
+/*
+@brief multiplies a vector by a matrix over GF(2), the matrix a column per bit
+
+@param mat: the matrix
+@param vec: the vector
+
+@return the product
+*/
+static uint32_t gf2_times(const uint32_t *mat, uint32_t vec){
+    uint32_t sum = 0;
+    for(; vec != 0; vec >>= 1, mat++){
+        if(vec & 1) sum ^= *mat;
+    }
+    return sum;
+}
+
+/*
+@brief multiplies two matrices over GF(2), into a third
+
+@param out: the product, may not be a or b
+@param a: the left matrix
+@param b: the right matrix
+*/
+static void gf2_multiply(uint32_t *out, const uint32_t *a, const uint32_t *b){
+    for(int n = 0; n < 32; n++) out[n] = gf2_times(a, b[n]);
+}
+
+/*
+@brief the operator that feeds len zero bytes through a CRC register, as in zlib's crc32_combine()
+
+@param op: where to store it
+@param len: the number of bytes
+*/
+static void zeros_operator(uint32_t *op, size_t len){
+    uint32_t power[32], next[32], product[32];
+    // one zero bit, then squared up to one zero byte
+    power[0] = POLY;
+    for(int n = 1; n < 32; n++) power[n] = 1u << (n - 1);
+    for(int i = 0; i < 3; i++){
+        gf2_multiply(next, power, power);
+        memcpy(power, next, sizeof(power));
+    }
+    for(int n = 0; n < 32; n++) op[n] = 1u << n;
+    // the product of the powers of two that make up len
+    while(len > 0){
+        if(len & 1){
+            gf2_multiply(product, power, op);
+            memcpy(op, product, sizeof(product));
+        }
+        len >>= 1;
+        if(len == 0) break;
+        gf2_multiply(next, power, power);
+        memcpy(power, next, sizeof(power));
+    }
+}
+
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2){
+    if(len2 == 0) return crc1;
+    uint32_t op[32];
+    zeros_operator(op, len2);
+    return gf2_times(op, crc1) ^ crc2;
+}
+
+void crc32c_shift_init(struct crc32c_shift *shift, size_t len){
+    uint32_t op[32];
+    zeros_operator(op, len);
+    // the operator is linear, so it is the XOR of what it does to each byte
+    for(int b = 0; b < 4; b++){
+        for(uint32_t v = 0; v < 256; v++) shift->table[b][v] = gf2_times(op, v << (8 * b));
+    }
+}
+
+uint32_t crc32c_shift_combine(const struct crc32c_shift *shift, uint32_t crc1, uint32_t crc2){
+    return shift->table[0][crc1 & 0xff] ^ shift->table[1][(crc1 >> 8) & 0xff] ^ shift->table[2][(crc1 >> 16) & 0xff] ^
+           shift->table[3][crc1 >> 24] ^ crc2;
+}
+
+uint32_t crc32c_packet(const struct packet_header *hdr, uint32_t payload_crc){
+    struct packet_header covered = *hdr;
+    covered.crc = 0;
+    return crc32c(payload_crc, &covered, sizeof(covered));
+}
+
+uint32_t crc32c_control(const void *datagram, size_t len){
+    static const char zeros[sizeof(((struct packet_header *)0)->crc)];
+    size_t at = offsetof(struct packet_header, crc);
+    if(len < at + sizeof(zeros)) return crc32c(0, datagram, len);
+    uint32_t crc = crc32c(0, datagram, at);
+    crc = crc32c(crc, zeros, sizeof(zeros));
+    return crc32c(crc, (const char *)datagram + at + sizeof(zeros), len - at - sizeof(zeros));
+}
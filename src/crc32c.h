@@ -0,0 +1,101 @@
+/*
+@file crc32c.h
+@brief CRC32C (Castagnoli) checksums of packets, and of a whole transfer built from them
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+/*
+@brief appending a fixed number of bytes to a CRC, as four byte-indexed tables
+
+crc32c_combine() works out the operator for any length, which takes a
+few thousand operations. Packets are all the same size but the last,
+so the receiver and sender work it out once and apply it with four
+lookups per packet.
+*/
+struct crc32c_shift {
+    uint32_t table[4][256];
+};
+
+/*
+@brief extends a CRC32C over more data, with the SSE4.2 instruction where the CPU has it
+
+@param crc: the CRC of the data so far, 0 for none
+@param data: the data to add
+@param len: its length
+
+@return the CRC of both
+*/
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+
+/*
+@brief the CRC32C implementation crc32c() picked for this CPU
+
+@return "sse4.2" or "table"
+*/
+const char *crc32c_name(void);
+
+/*
+@brief the CRC of two pieces of data one after the other, from their CRCs
+
+@param crc1: the first piece's CRC
+@param crc2: the second piece's CRC
+@param len2: the second piece's length
+
+@return the CRC of both
+*/
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
+/*
+@brief works out the operator crc32c_combine() uses for one length
+
+@param shift: where to store it
+@param len: the length of the pieces it appends
+*/
+void crc32c_shift_init(struct crc32c_shift *shift, size_t len);
+
+/*
+@brief crc32c_combine() for a piece of the length the operator was made for
+
+@param shift: the operator
+@param crc1: the first piece's CRC
+@param crc2: the second piece's CRC
+
+@return the CRC of both
+*/
+uint32_t crc32c_shift_combine(const struct crc32c_shift *shift, uint32_t crc1, uint32_t crc2);
+
+/*
+@brief the crc field of a packet, covering its header and its payload
+
+@param hdr: the header, its crc field is left out
+@param payload_crc: the CRC of everything after the header
+
+@return the value for hdr->crc
+*/
+uint32_t crc32c_packet(const struct packet_header *hdr, uint32_t payload_crc);
+
+/*
+@brief the crc field of any other datagram: handshakes, acks, probes and the like
+
+Every datagram has its crc field where struct packet_header does, so
+this works for struct packet, struct ack_packet and bare headers alike.
+
+@param datagram: the whole datagram, its crc field is left out
+@param len: its length
+
+@return the value for its crc field
+*/
+uint32_t crc32c_control(const void *datagram, size_t len);
+
+#endif
@@ -0,0 +1,198 @@
+/*
+@file endpoint.h
+@brief where a transfer's data comes from and goes to: memory, a file descriptor or a callback
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef ENDPOINT_H
+#define ENDPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+
+#define RDT_NAME_MAX 256
+
+/*
+@brief reads the next bytes of a transfer
+
+@param arg: the callback's argument
+@param buf: where to put them
+@param len: the most to read
+
+@return the bytes read, 0 at the end of the data
+*/
+typedef size_t (*rdt_read_fn)(void *arg, void *buf, size_t len);
+
+/*
+@brief takes the next bytes of a transfer, always in order
+
+@param arg: the callback's argument
+@param buf: the bytes
+@param len: how many
+
+@return 0 to abort the transfer, 1 otherwise
+*/
+typedef int (*rdt_write_fn)(void *arg, const void *buf, size_t len);
+
+enum rdt_endpoint_kind {
+    RDT_MEMORY,
+    RDT_FD,
+    RDT_CALLBACK
+};
+
+/*
+@brief what a sender reads
+
+Memory and regular files are sent straight from memory, a file
+descriptor is mapped when it can be. Pipes, sockets and callbacks are
+read a packet at a time.
+*/
+struct rdt_source {
+    enum rdt_endpoint_kind kind;
+    const char *data;           // RDT_MEMORY
+    size_t len;
+    int fd;                     // RDT_FD
+    rdt_read_fn read;           // RDT_CALLBACK
+    void *arg;
+};
+
+/*
+@brief where a receiver puts the data
+
+Memory and seekable files take each packet at its offset as it
+arrives, files through a writer thread. Pipes, sockets and callbacks
+get the data in order, packets past a gap wait in the reorder buffer.
+A memory sink must be large enough for the sender's range, data past
+its end aborts the transfer. A file with a journal, see resume.h, keeps
+track of what is safely on disk, so a transfer that is cut off resumes
+where it stopped.
+*/
+struct rdt_sink {
+    enum rdt_endpoint_kind kind;
+    char *data;                 // RDT_MEMORY
+    size_t len;
+    int fd;                     // RDT_FD
+    rdt_write_fn write;         // RDT_CALLBACK
+    void *arg;                  // RDT_CALLBACK, left to the owner otherwise
+    const char *journal;        // RDT_FD: the resume journal, NULL for none
+};
+
+/*
+@brief what a receiver knows about one transfer
+*/
+struct rdt_transfer {
+    int conn_id;
+    struct sockaddr_in peer;
+    char name[RDT_NAME_MAX];        // the sender's name for the data, may be empty
+    unsigned long long offset;      // where the sender's range starts in the whole file
+    unsigned long long file_length; // the whole file's length, 0 if unknown
+    long long mtime;                // the sender's file modification time in nanoseconds, 0 if unknown
+    unsigned long long resumed;     // bytes at the range's start already on disk from an earlier try, not sent again
+    unsigned long long bytes_expected;
+    unsigned long long bytes_received;
+    unsigned long long packets_received;
+    unsigned long long duplicates;      // packets that had already arrived
+    unsigned long long out_of_order;    // packets that arrived past a gap
+    int reorder_peak;                   // most packets buffered past a gap at once
+    unsigned long long fec_recovered;   // lost packets rebuilt from parity
+    unsigned long long corrupt;         // packets dropped because their CRC didn't match
+    unsigned int digest;                // CRC32C of the data received in order so far
+    int digest_match;                   // 1 if the sender's digest matched, 0 if not, -1 if none came
+    uint64_t started_us;
+    uint64_t finished_us;           // when the last byte arrived, 0 if it didn't
+};
+
+/*
+@brief a source that sends len bytes of memory
+
+@param data: the bytes, they must stay valid for the transfer
+@param len: how many
+
+@return the source
+*/
+static inline struct rdt_source rdt_source_memory(const void *data, size_t len){
+    struct rdt_source src = {RDT_MEMORY, (const char *)data, len, -1, NULL, NULL};
+    return src;
+}
+
+/*
+@brief a source that reads a file descriptor, from the transfer's offset if it can seek
+
+@param fd: the descriptor, the caller closes it
+
+@return the source
+*/
+static inline struct rdt_source rdt_source_fd(int fd){
+    struct rdt_source src = {RDT_FD, NULL, 0, fd, NULL, NULL};
+    return src;
+}
+
+/*
+@brief a source that calls read for the data
+
+@param read: the callback
+@param arg: its argument
+
+@return the source
+*/
+static inline struct rdt_source rdt_source_callback(rdt_read_fn read, void *arg){
+    struct rdt_source src = {RDT_CALLBACK, NULL, 0, -1, read, arg};
+    return src;
+}
+
+/*
+@brief a sink that stores the data at its offset in len bytes of memory
+
+@param data: the buffer
+@param len: its size
+
+@return the sink
+*/
+static inline struct rdt_sink rdt_sink_memory(void *data, size_t len){
+    struct rdt_sink sink = {RDT_MEMORY, (char *)data, len, -1, NULL, NULL, NULL};
+    return sink;
+}
+
+/*
+@brief a sink that writes a file descriptor
+
+@param fd: the descriptor, the caller closes it
+
+@return the sink
+*/
+static inline struct rdt_sink rdt_sink_fd(int fd){
+    struct rdt_sink sink = {RDT_FD, NULL, 0, fd, NULL, NULL, NULL};
+    return sink;
+}
+
+/*
+@brief a sink that writes a file descriptor and resumes an interrupted transfer of the same file
+
+@param fd: the descriptor, the caller closes it
+@param journal: the resume journal's name, see resume_journal_path(), it must stay valid until the transfer is over
+
+@return the sink
+*/
+static inline struct rdt_sink rdt_sink_resumable(int fd, const char *journal){
+    struct rdt_sink sink = {RDT_FD, NULL, 0, fd, NULL, NULL, journal};
+    return sink;
+}
+
+/*
+@brief a sink that hands the data to write, in order
+
+@param write: the callback
+@param arg: its argument
+
+@return the sink
+*/
+static inline struct rdt_sink rdt_sink_callback(rdt_write_fn write, void *arg){
+    struct rdt_sink sink = {RDT_CALLBACK, NULL, 0, -1, write, arg, NULL};
+    return sink;
+}
+
+#endif
@@ -0,0 +1,256 @@
+/*
+@file fec.c
+@brief XOR parity over blocks of data packets, so a lost packet is rebuilt instead of resent
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "fec.h"
+
+/*
+@brief XORs a word at a time, for CPUs without the vector units below
+
+@param dst: the bytes to update
+@param src: the bytes to XOR in
+@param len: how many
+*/
+static void xor_scalar(char *dst, const char *src, size_t len){
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8){
+        uint64_t a, b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for(; i < len; i++) dst[i] ^= src[i];
+}
+
+#if defined(__x86_64__)
+/*
+@brief XORs 16 bytes at a time, SSE2 is part of every x86-64 CPU
+
+@param dst: the bytes to update
+@param src: the bytes to XOR in
+@param len: how many
+*/
+static void xor_sse2(char *dst, const char *src, size_t len){
+    size_t i = 0;
+    for(; i + 16 <= len; i += 16){
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(a, b));
+    }
+    xor_scalar(dst + i, src + i, len - i);
+}
+
+/*
+@brief XORs 32 bytes at a time, built for AVX2 whatever the compiler flags and only called where the CPU has it
+
+@param dst: the bytes to update
+@param src: the bytes to XOR in
+@param len: how many
+*/
+__attribute__((target("avx2"))) static void xor_avx2(char *dst, const char *src, size_t len){
+    size_t i = 0;
+    for(; i + 32 <= len; i += 32){
+        __m256i a = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(a, b));
+    }
+    xor_scalar(dst + i, src + i, len - i);
+}
+#endif
+
+static void (*xor_impl)(char *dst, const char *src, size_t len);
+static const char *xor_impl_name;
+
+/*
+@brief picks the widest XOR this CPU runs, once
+*/
+static void pick_xor(void){
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2")){
+        xor_impl_name = "avx2";
+        xor_impl = xor_avx2;
+        return;
+    }
+    xor_impl_name = "sse2";
+    xor_impl = xor_sse2;
+#else
+    xor_impl_name = "scalar";
+    xor_impl = xor_scalar;
+#endif
+}
+
+void fec_xor(void *dst, const void *src, size_t len){
+    if(xor_impl == NULL) pick_xor();
+    xor_impl(dst, src, len);
+}
+
+const char *fec_xor_name(void){
+    if(xor_impl == NULL) pick_xor();
+    return xor_impl_name;
+}
+
+int fec_encoder_init(struct fec_encoder *enc, int k, int payload_size){
+    memset(enc, 0, sizeof(*enc));
+    enc->k = k;
+    enc->payload_size = payload_size;
+    enc->datagram = calloc(1, sizeof(struct packet_header) + sizeof(struct fec_header) + payload_size);
+    return enc->datagram != NULL;
+}
+
+void fec_encoder_free(struct fec_encoder *enc){
+    free(enc->datagram);
+    enc->datagram = NULL;
+}
+
+int fec_encoder_add(struct fec_encoder *enc, long long seq, const void *payload, int len){
+    char *parity = enc->datagram + sizeof(struct packet_header) + sizeof(struct fec_header);
+    if(enc->count == 0){
+        enc->first_seq = seq;
+        memset(parity, 0, enc->payload_size);
+    }
+    fec_xor(parity, payload, len);
+    enc->len_xor ^= len;
+    if(len > enc->max_len) enc->max_len = len;
+    enc->count++;
+    return (seq + 1) % enc->k == 0;
+}
+
+size_t fec_encoder_finish(struct fec_encoder *enc, int conn_id){
+    if(enc->count == 0) return 0;
+    struct packet_header hdr;
+    struct fec_header fec;
+    hdr.seq_num = -5;
+    hdr.data_len = enc->max_len;
+    hdr.conn_id = conn_id;
+    hdr.crc = 0;
+    fec.first_seq = seq_wire(enc->first_seq);
+    fec.count = enc->count;
+    fec.len_xor = enc->len_xor;
+    memcpy(enc->datagram, &hdr, sizeof(hdr));
+    memcpy(enc->datagram + sizeof(hdr), &fec, sizeof(fec));
+    size_t len = sizeof(hdr) + sizeof(fec) + enc->max_len;
+
+    // the caller sends a copy, the parity starts over for the next block
+    enc->count = 0;
+    enc->len_xor = 0;
+    enc->max_len = 0;
+    return len;
+}
+
+int fec_decoder_init(struct fec_decoder *dec, int k, int payload_size, int blocks){
+    memset(dec, 0, sizeof(*dec));
+    dec->k = k;
+    dec->payload_size = payload_size;
+    dec->blocks = blocks;
+    dec->meta = malloc(blocks * sizeof(*dec->meta));
+    dec->acc = malloc((size_t)blocks * payload_size);
+    if(dec->meta == NULL || dec->acc == NULL){
+        fec_decoder_free(dec);
+        return 0;
+    }
+    for(int i = 0; i < blocks; i++) dec->meta[i].block = -1;
+    return 1;
+}
+
+void fec_decoder_free(struct fec_decoder *dec){
+    free(dec->meta);
+    free(dec->acc);
+    dec->meta = NULL;
+    dec->acc = NULL;
+}
+
+/*
+@brief the slot of a block, taking it over from an older block
+
+@param dec: the decoder
+@param block: the block number
+
+@return the slot, -1 if a newer block already has it
+*/
+static int block_slot(struct fec_decoder *dec, long long block){
+    int slot = block & (dec->blocks - 1);
+    struct fec_block *b = &dec->meta[slot];
+    if(b->block == block) return slot;
+    if(b->block > block) return -1;
+    memset(b, 0, sizeof(*b));
+    b->block = block;
+    memset(dec->acc + (size_t)slot * dec->payload_size, 0, dec->payload_size);
+    return slot;
+}
+
+/*
+@brief whether a block is down to one missing packet with its parity in
+
+@param dec: the decoder
+@param slot: the block's slot
+
+@return the slot if it can be rebuilt, -1 otherwise
+*/
+static int recoverable(const struct fec_decoder *dec, int slot){
+    const struct fec_block *b = &dec->meta[slot];
+    if(b->parity_count == 0 || b->recovered) return -1;
+    return __builtin_popcountll(b->received) == b->parity_count - 1 ? slot : -1;
+}
+
+int fec_decoder_add(struct fec_decoder *dec, long long seq, const void *payload, int len){
+    int slot = block_slot(dec, seq / dec->k);
+    if(slot < 0 || len > dec->payload_size) return -1;
+    struct fec_block *b = &dec->meta[slot];
+    uint64_t bit = 1ULL << (seq % dec->k);
+    if(b->recovered || (b->received & bit)) return -1;
+    b->received |= bit;
+    b->len_xor ^= len;
+    fec_xor(dec->acc + (size_t)slot * dec->payload_size, payload, len);
+    return recoverable(dec, slot);
+}
+
+int fec_decoder_add_parity(struct fec_decoder *dec, long long first_seq, int count, int len_xor, const void *parity, int len){
+    // a block never spans two, the sender starts one every k sequence numbers
+    if(first_seq < 0 || count < 1 || count > dec->k || len > dec->payload_size ||
+       first_seq / dec->k != (first_seq + count - 1) / dec->k){
+        return -1;
+    }
+    int slot = block_slot(dec, first_seq / dec->k);
+    if(slot < 0) return -1;
+    struct fec_block *b = &dec->meta[slot];
+    if(b->parity_count != 0) return -1;
+    b->parity_count = count;
+    b->first_seq = first_seq;
+    b->len_xor ^= len_xor;
+    fec_xor(dec->acc + (size_t)slot * dec->payload_size, parity, len);
+    return recoverable(dec, slot);
+}
+
+int fec_decoder_has_parity(const struct fec_decoder *dec, long long seq){
+    const struct fec_block *b = &dec->meta[(seq / dec->k) & (dec->blocks - 1)];
+    return b->block == seq / dec->k && b->parity_count != 0;
+}
+
+const char *fec_decoder_recover(struct fec_decoder *dec, int slot, long long *seq, int *len){
+    struct fec_block *b = &dec->meta[slot];
+    if(recoverable(dec, slot) < 0) return NULL;
+    b->recovered = 1;
+    int first = b->first_seq % dec->k;
+    for(int i = first; i < first + b->parity_count; i++){
+        if(!(b->received & (1ULL << i))){
+            *seq = b->block * dec->k + i;
+            break;
+        }
+    }
+    *len = b->len_xor;
+    if(*len <= 0 || *len > dec->payload_size) return NULL;
+    return dec->acc + (size_t)slot * dec->payload_size;
+}
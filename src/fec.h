@@ -0,0 +1,191 @@
+/*
+@file fec.h
+@brief XOR parity over blocks of data packets, so a lost packet is rebuilt instead of resent
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef FEC_H
+#define FEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+#define FEC_MAX_K 64        // data packets per block, one bit each in a block's mask
+#define FEC_BLOCKS 64       // blocks the receiver rebuilds from at once, a power of two
+
+/*
+@brief the sender's parity for the block being sent
+
+Block b covers sequence numbers [b * k, (b + 1) * k). Each new data
+packet is XORed into parity as it is sent, so the parity datagram is
+ready the moment the block's last packet goes out. datagram holds the
+parity packet as it goes on the wire: packet_header, fec_header, parity.
+*/
+struct fec_encoder {
+    int k;
+    int count;                  // packets in the block so far
+    long long first_seq;
+    int len_xor;
+    int max_len;
+    int payload_size;
+    char *datagram;
+};
+
+/*
+@brief what the receiver knows about one block
+*/
+struct fec_block {
+    long long block;            // the block number, -1 for an unused slot
+    uint64_t received;          // bit seq % k for every packet that arrived
+    int len_xor;                // data_len of every packet and the parity, XORed
+    int parity_count;           // the packets the parity covers, 0 until it arrives
+    long long first_seq;        // the parity's first packet
+    int recovered;
+};
+
+/*
+@brief the receiver's blocks, a ring of FEC_BLOCKS
+
+Every arriving packet is XORed into its block's accumulator. Once the
+parity is in too and exactly one packet is missing, the accumulator
+is that packet, so only one payload per block is kept however many
+packets the block has.
+*/
+struct fec_decoder {
+    int k;
+    int payload_size;
+    int blocks;
+    struct fec_block *meta;
+    char *acc;                  // blocks * payload_size bytes
+};
+
+/*
+@brief XORs src into dst, with AVX2 or SSE2 where the CPU has them
+
+@param dst: the bytes to update
+@param src: the bytes to XOR in
+@param len: how many
+*/
+void fec_xor(void *dst, const void *src, size_t len);
+
+/*
+@brief the XOR implementation fec_xor() picked for this CPU
+
+@return "avx2", "sse2" or "scalar"
+*/
+const char *fec_xor_name(void);
+
+/*
+@brief allocates a sender's parity buffer
+
+@param enc: the encoder to initialize
+@param k: data packets per block, 1 to FEC_MAX_K
+@param payload_size: the negotiated payload size
+
+@return 0 in case of failure, 1 in case of success
+*/
+int fec_encoder_init(struct fec_encoder *enc, int k, int payload_size);
+
+/*
+@brief releases the parity buffer
+
+@param enc: the encoder
+*/
+void fec_encoder_free(struct fec_encoder *enc);
+
+/*
+@brief XORs a new data packet into its block's parity
+
+@param enc: the encoder
+@param seq: the packet's full sequence number
+@param payload: its data
+@param len: its length
+
+@return 1 if that was the block's last packet and the parity is due, 0 otherwise
+*/
+int fec_encoder_add(struct fec_encoder *enc, long long seq, const void *payload, int len);
+
+/*
+@brief finishes the block's parity datagram, also for a block cut short by the end of the data
+
+@param enc: the encoder
+@param conn_id: the connection ID to stamp on it
+
+@return the datagram's length, 0 if the block is empty. The datagram is
+enc->datagram and stays valid until the next fec_encoder_add()
+*/
+size_t fec_encoder_finish(struct fec_encoder *enc, int conn_id);
+
+/*
+@brief allocates a receiver's blocks
+
+@param dec: the decoder to initialize
+@param k: data packets per block, 1 to FEC_MAX_K
+@param payload_size: the negotiated payload size
+@param blocks: how many blocks to track, a power of two
+
+@return 0 in case of failure, 1 in case of success
+*/
+int fec_decoder_init(struct fec_decoder *dec, int k, int payload_size, int blocks);
+
+/*
+@brief releases the blocks
+
+@param dec: the decoder
+*/
+void fec_decoder_free(struct fec_decoder *dec);
+
+/*
+@brief counts a data packet that arrived for the first time
+
+@param dec: the decoder
+@param seq: its full sequence number
+@param payload: its data
+@param len: its length
+
+@return the block's slot if its missing packet can now be rebuilt, -1 otherwise
+*/
+int fec_decoder_add(struct fec_decoder *dec, long long seq, const void *payload, int len);
+
+/*
+@brief takes a block's parity
+
+@param dec: the decoder
+@param first_seq: the full sequence number of the block's first packet
+@param count: the packets it covers
+@param len_xor: their lengths XORed
+@param parity: the parity bytes
+@param len: their length
+
+@return the block's slot if its missing packet can now be rebuilt, -1 otherwise
+*/
+int fec_decoder_add_parity(struct fec_decoder *dec, long long first_seq, int count, int len_xor, const void *parity, int len);
+
+/*
+@brief whether a block's parity already arrived
+
+@param dec: the decoder
+@param seq: a sequence number in the block
+
+@return 1 if it did, 0 if it may still come
+*/
+int fec_decoder_has_parity(const struct fec_decoder *dec, long long seq);
+
+/*
+@brief rebuilds a block's one missing packet
+
+@param dec: the decoder
+@param slot: the slot fec_decoder_add() or fec_decoder_add_parity() returned
+@param seq: where to store the packet's sequence number
+@param len: where to store its length
+
+@return its data, valid until the slot's next block, NULL if it can't be rebuilt
+*/
+const char *fec_decoder_recover(struct fec_decoder *dec, int slot, long long *seq, int *len);
+
+#endif
@@ -0,0 +1,213 @@
+/*
+@file file_writer.c
+@brief writer thread that puts received data at its file offset with pwrite
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#define _GNU_SOURCE // for pwritev
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "file_writer.h"
+
+/*
+@brief the queue slot a position maps to
+
+@param writer: the writer
+@param pos: a head or tail position
+
+@return the slot
+*/
+static inline struct write_request *slot_at(struct file_writer *writer, uint64_t pos){
+    return (struct write_request *)(writer->slots + (pos & (writer->capacity - 1)) * writer->slot_size);
+}
+
+/*
+@brief writes a run of adjacent requests with as few pwritev calls as it takes
+
+@param writer: the writer
+@param first: the queue position of the run's first request
+@param count: how many requests, at most WRITE_BATCH
+
+@return 0 in case of failure, 1 in case of success
+*/
+static int write_run(struct file_writer *writer, uint64_t first, int count){
+    struct iovec iov[WRITE_BATCH];
+    size_t total = 0;
+    for(int i = 0; i < count; i++){
+        struct write_request *req = slot_at(writer, first + i);
+        iov[i].iov_base = req->data;
+        iov[i].iov_len = req->len;
+        total += req->len;
+    }
+    token_bucket_wait(&writer->limit, total);
+
+    uint64_t offset = slot_at(writer, first)->offset;
+    struct iovec *next = iov;
+    int left = count;
+    while(total > 0){
+        ssize_t n = pwritev(writer->fd, next, left, offset);
+        if(n < 0){
+            if(errno == EINTR) continue;
+            perror("Failed to write to file");
+            return 0;
+        }
+        atomic_fetch_add(&writer->bytes_written, n);
+        offset += n;
+        total -= n;
+        // a short write: skip what went out and carry on from there
+        while(left > 0 && (size_t)n >= next->iov_len){
+            n -= next->iov_len;
+            next++;
+            left--;
+        }
+        if(left > 0){
+            next->iov_base = (char *)next->iov_base + n;
+            next->iov_len -= n;
+        }
+    }
+    return 1;
+}
+
+/*
+@brief the writer thread: drains the queue, merging adjacent writes
+
+@param arg: the struct file_writer
+
+@return NULL
+*/
+static void *writer_main(void *arg){
+    struct file_writer *writer = arg;
+    while(1){
+        uint64_t head = atomic_load(&writer->head);
+        uint64_t tail = atomic_load(&writer->tail);
+        if(head == tail){
+            // park until the producer commits or closes, checking again under the lock
+            pthread_mutex_lock(&writer->lock);
+            atomic_store(&writer->writer_waiting, 1);
+            while(atomic_load(&writer->tail) == head && !atomic_load(&writer->closed)){
+                pthread_cond_wait(&writer->has_work, &writer->lock);
+            }
+            atomic_store(&writer->writer_waiting, 0);
+            pthread_mutex_unlock(&writer->lock);
+            if(atomic_load(&writer->tail) == head) break;
+            continue;
+        }
+
+        int count = tail - head < WRITE_BATCH ? (int)(tail - head) : WRITE_BATCH;
+        int start = 0;
+        for(int i = 1; i <= count; i++){
+            struct write_request *prev = slot_at(writer, head + i - 1);
+            struct write_request *next = i < count ? slot_at(writer, head + i) : NULL;
+            if(next != NULL && prev->len >= 0 && next->len >= 0 && next->offset == prev->offset + prev->len) continue;
+            // after a failure keep draining, so the producer never waits on a dead writer
+            if(prev->len == WRITE_MARK){
+                if(!atomic_load(&writer->failed) && writer->on_mark != NULL) writer->on_mark(writer->mark_arg, prev->offset);
+            } else if(!atomic_load(&writer->failed) && write_run(writer, head + start, i - start) == 0){
+                atomic_store(&writer->failed, 1);
+            }
+            start = i;
+        }
+
+        atomic_store(&writer->head, head + count);
+        if(atomic_load(&writer->producer_waiting)){
+            pthread_mutex_lock(&writer->lock);
+            pthread_cond_signal(&writer->has_room);
+            pthread_mutex_unlock(&writer->lock);
+        }
+    }
+    return NULL;
+}
+
+size_t file_writer_slot_size(int max_len){
+    return (sizeof(struct write_request) + max_len + 7) / 8 * 8;
+}
+
+int file_writer_start(struct file_writer *writer, int fd, int capacity, uint64_t rate, int max_len){
+    memset(writer, 0, sizeof(*writer));
+    int rounded = 1;
+    while(rounded < capacity) rounded <<= 1;
+
+    writer->slot_size = file_writer_slot_size(max_len);
+    writer->slots = malloc((size_t)rounded * writer->slot_size);
+    if(writer->slots == NULL){
+        perror("file writer malloc failed");
+        return 0;
+    }
+    writer->fd = fd;
+    writer->capacity = rounded;
+    double burst = (double)rate * WRITE_BURST_MS / 1000;
+    if(burst < (double)WRITE_BATCH * max_len) burst = (double)WRITE_BATCH * max_len;
+    token_bucket_init(&writer->limit, rate, burst);
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->has_work, NULL);
+    pthread_cond_init(&writer->has_room, NULL);
+    int err = pthread_create(&writer->thread, NULL, writer_main, writer);
+    if(err != 0){
+        fprintf(stderr, "failed to start the writer thread: %s\n", strerror(err));
+        pthread_mutex_destroy(&writer->lock);
+        pthread_cond_destroy(&writer->has_work);
+        pthread_cond_destroy(&writer->has_room);
+        free(writer->slots);
+        writer->slots = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+struct write_request *file_writer_reserve(struct file_writer *writer){
+    uint64_t tail = atomic_load(&writer->tail);
+    if(tail - atomic_load(&writer->head) == (uint64_t)writer->capacity){
+        // the disk is behind, wait for the writer to free a slot
+        pthread_mutex_lock(&writer->lock);
+        atomic_store(&writer->producer_waiting, 1);
+        while(tail - atomic_load(&writer->head) == (uint64_t)writer->capacity){
+            pthread_cond_wait(&writer->has_room, &writer->lock);
+        }
+        atomic_store(&writer->producer_waiting, 0);
+        pthread_mutex_unlock(&writer->lock);
+    }
+    return slot_at(writer, tail);
+}
+
+void file_writer_commit(struct file_writer *writer){
+    atomic_fetch_add(&writer->tail, 1);
+    if(atomic_load(&writer->writer_waiting)){
+        pthread_mutex_lock(&writer->lock);
+        pthread_cond_signal(&writer->has_work);
+        pthread_mutex_unlock(&writer->lock);
+    }
+}
+
+void file_writer_mark(struct file_writer *writer, uint64_t mark){
+    struct write_request *req = file_writer_reserve(writer);
+    req->offset = mark;
+    req->len = WRITE_MARK;
+    file_writer_commit(writer);
+}
+
+int file_writer_space(struct file_writer *writer){
+    return writer->capacity - (int)(atomic_load(&writer->tail) - atomic_load(&writer->head));
+}
+
+int file_writer_finish(struct file_writer *writer){
+    if(writer->slots == NULL) return 0;
+    pthread_mutex_lock(&writer->lock);
+    atomic_store(&writer->closed, 1);
+    pthread_cond_signal(&writer->has_work);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->has_work);
+    pthread_cond_destroy(&writer->has_room);
+    free(writer->slots);
+    writer->slots = NULL;
+    return !atomic_load(&writer->failed);
+}
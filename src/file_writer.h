@@ -0,0 +1,135 @@
+/*
+@file file_writer.h
+@brief writer thread that puts received data at its file offset with pwrite
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef FILE_WRITER_H
+#define FILE_WRITER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "token_bucket.h"
+
+#define WRITE_QUEUE_SIZE 4096   // default queued writes, a power of two
+#define WRITE_BATCH 64          // most queued writes merged into one pwritev
+#define WRITE_BURST_MS 50       // the most a throttled writer catches up on after idling
+#define WRITE_MARK -1           // the len of a queued mark, see file_writer_mark()
+
+/*
+@brief one pending write: the bytes and where they go in the file
+
+each slot is followed by room for the largest write, see
+file_writer_start()
+*/
+struct write_request {
+    uint64_t offset;
+    int len;
+    char data[];
+};
+
+/*
+@brief a single producer, single consumer queue drained by a writer thread
+
+The receive loop reserves a slot, copies a payload into it and commits
+it, the writer thread writes it at its offset. Head and tail are
+atomics, so neither side takes a lock while the queue has work or room;
+the mutex and condition variables only park a side that has to wait.
+Adjacent writes are merged into one pwritev, and a merged write is
+charged to the rate limit as a whole. A mark in the queue tells on_mark
+once the writes queued before it are done.
+*/
+struct file_writer {
+    int fd;
+    char *slots;
+    size_t slot_size;
+    int capacity;               // a power of two
+    _Atomic uint64_t head;      // next slot the writer takes, written by the writer
+    _Atomic uint64_t tail;      // next slot the producer fills, written by the producer
+    atomic_int closed;
+    atomic_int failed;
+    atomic_int writer_waiting;
+    atomic_int producer_waiting;
+    pthread_mutex_t lock;
+    pthread_cond_t has_work;
+    pthread_cond_t has_room;
+    pthread_t thread;
+    struct token_bucket limit;  // only touched by the writer thread
+    _Atomic uint64_t bytes_written;
+    void (*on_mark)(void *arg, uint64_t mark);  // called by the writer thread at each mark, may be NULL
+    void *mark_arg;
+};
+
+/*
+@brief allocates the queue and starts the writer thread
+
+@param writer: the writer to start
+@param fd: the file to write to, opened for writing
+@param capacity: how many writes may be queued, rounded up to a power of two
+@param rate: the most bytes written per second, 0 for no limit
+@param max_len: the largest single write, e.g. the payload size
+
+@return 0 in case of failure, 1 in case of success
+*/
+int file_writer_start(struct file_writer *writer, int fd, int capacity, uint64_t rate, int max_len);
+
+/*
+@brief the memory one queued write takes
+
+@param max_len: the largest single write
+
+@return the bytes per queue slot, so capacity times this is the queue's size
+*/
+size_t file_writer_slot_size(int max_len);
+
+/*
+@brief takes the next free slot, waiting for the writer if the queue is full
+
+@param writer: the writer
+
+@return the slot to fill in, it is not written until file_writer_commit()
+*/
+struct write_request *file_writer_reserve(struct file_writer *writer);
+
+/*
+@brief hands the slot from file_writer_reserve() to the writer thread
+
+@param writer: the writer
+*/
+void file_writer_commit(struct file_writer *writer);
+
+/*
+@brief queues a mark: once every write queued before it is done, on_mark gets it
+
+Not called after a write failed.
+
+@param writer: the writer, its on_mark set before the first mark
+@param mark: passed to on_mark
+*/
+void file_writer_mark(struct file_writer *writer, uint64_t mark);
+
+/*
+@brief how many writes can be queued without waiting
+
+@param writer: the writer
+
+@return the free slots
+*/
+int file_writer_space(struct file_writer *writer);
+
+/*
+@brief waits for every queued write, stops the thread and releases the queue
+
+@param writer: the writer
+
+@return 0 if any write failed, 1 in case of success
+*/
+int file_writer_finish(struct file_writer *writer);
+
+#endif
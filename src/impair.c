@@ -0,0 +1,459 @@
+/*
+@file impair.c
+@brief a UDP proxy that impairs the path between a sender and a receiver, for testing and benchmarks
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#define _GNU_SOURCE // for ppoll
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include "clock.h"
+#include "timer_heap.h"
+
+#define MAX_CLIENTS 64                  // senders proxied at once, the least recently heard is replaced
+#define MAX_QUEUED 65536                // datagrams held back at once, past it they are dropped
+#define MAX_DATAGRAM 65536
+#define QUEUE_BYTES (1 << 20)           // default bytes waiting for the bandwidth cap before tail drop
+#define REORDER_GAP_US 1000             // default extra delay of a reordered datagram
+#define SOCKET_BUFFER (8 << 20)         // the proxy shouldn't be where datagrams get lost unasked
+
+/*
+@brief one direction of the path: client to target is forward, target to client is reverse
+*/
+enum direction {
+    FORWARD,
+    REVERSE
+};
+
+/*
+@brief what was done to the datagrams going one way
+*/
+struct path_stats {
+    unsigned long long received;
+    unsigned long long forwarded;
+    unsigned long long lost;
+    unsigned long long duplicated;
+    unsigned long long corrupted;       // one bit flipped, as a bad link that slips past the UDP checksum would
+    unsigned long long reordered;
+    unsigned long long overflowed;      // tail dropped by the bandwidth cap's queue
+};
+
+/*
+@brief a sender talking through the proxy, with its own socket towards the target
+
+the target sees each client as a different address, so a receiver
+serving many senders keeps them apart
+*/
+struct client {
+    struct sockaddr_in addr;
+    int sockfd;
+    uint64_t last_heard_us;
+};
+
+/*
+@brief a datagram waiting for its departure time
+*/
+struct delayed {
+    int sockfd;
+    struct sockaddr_in to;
+    enum direction dir;
+    size_t len;
+    char data[];
+};
+
+double loss = 0;                // percent of datagrams dropped
+double duplicate = 0;           // percent sent twice
+double corrupt = 0;             // percent with one random bit flipped
+double reorder = 0;             // percent held back by reorder_gap_us, so later ones overtake them
+uint64_t reorder_gap_us = REORDER_GAP_US;
+uint64_t delay_us = 0;          // one way, both directions
+uint64_t jitter_us = 0;         // added to the delay, uniform in [0, jitter_us]
+uint64_t rate = 0;              // bytes/s of the forward direction, 0 for no cap
+uint64_t queue_bytes = QUEUE_BYTES;
+uint64_t rng_state = 1;
+volatile sig_atomic_t stopping = 0;
+
+int listen_fd = -1;
+struct sockaddr_in target;
+struct client clients[MAX_CLIENTS];
+int num_clients = 0;
+struct timer_heap departures;   // keyed by the struct delayed
+int num_delayed = 0;
+uint64_t link_free_us = 0;      // when the capped link finishes sending what it holds
+uint64_t last_departure_us[2];  // keeps each direction in order, but for reordered datagrams
+struct path_stats stats[2];
+
+/*
+@brief xorshift64*, seeded with -s so a run can be repeated
+
+@return a uniform random number in [0, 1)
+*/
+double random_unit(void){
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (double)((rng_state * 2685821657736338717ULL) >> 11) / (double)(1ULL << 53);
+}
+
+/*
+@brief draws whether something with a given chance happens
+
+@param percent: the chance, 0 to 100
+
+@return 1 if it happens, 0 otherwise
+*/
+int chance(double percent){
+    return percent > 0 && random_unit() * 100.0 < percent;
+}
+
+/*
+@brief opens a UDP socket with a large receive buffer
+
+@return the socket, -1 in case of failure
+*/
+int open_socket(void){
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(sockfd < 0){
+        perror("socket creation failed");
+        return -1;
+    }
+    int size = SOCKET_BUFFER;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    return sockfd;
+}
+
+/*
+@brief finds the client a datagram came from, taking a slot and a socket for a new one
+
+@param from: the datagram's source
+
+@return the client, or NULL if no socket could be opened for it
+*/
+struct client *find_client(const struct sockaddr_in *from){
+    int oldest = 0;
+    for(int i = 0; i < num_clients; i++){
+        if(clients[i].addr.sin_addr.s_addr == from->sin_addr.s_addr && clients[i].addr.sin_port == from->sin_port){
+            return &clients[i];
+        }
+        if(clients[i].last_heard_us < clients[oldest].last_heard_us) oldest = i;
+    }
+    struct client *c;
+    if(num_clients < MAX_CLIENTS){
+        c = &clients[num_clients];
+        c->sockfd = open_socket();
+        if(c->sockfd < 0) return NULL;
+        num_clients++;
+    } else {
+        c = &clients[oldest];
+    }
+    c->addr = *from;
+    return c;
+}
+
+/*
+@brief finds the client a target's answer is for
+
+@param sockfd: the socket it came in on
+
+@return the client, or NULL if the slot was given away
+*/
+struct client *client_by_socket(int sockfd){
+    for(int i = 0; i < num_clients; i++){
+        if(clients[i].sockfd == sockfd) return &clients[i];
+    }
+    return NULL;
+}
+
+/*
+@brief holds one copy of a datagram until its departure time
+
+@param dir: the way it is going
+@param sockfd: the socket to send it from
+@param to: where to send it
+@param data: the datagram
+@param len: its length
+@param now: the current monotonic time in microseconds
+*/
+void schedule(enum direction dir, int sockfd, const struct sockaddr_in *to, const char *data, size_t len, uint64_t now){
+    uint64_t depart = now;
+    // the cap serializes the forward direction, a datagram waits behind those already on the link
+    if(dir == FORWARD && rate > 0){
+        uint64_t start = link_free_us > now ? link_free_us : now;
+        if((start - now) * rate / 1000000ULL + len > queue_bytes){
+            stats[dir].overflowed++;
+            return;
+        }
+        link_free_us = start + len * 1000000ULL / rate;
+        depart = link_free_us;
+    }
+    depart += delay_us;
+    if(jitter_us > 0) depart += (uint64_t)(random_unit() * (jitter_us + 1));
+    if(chance(reorder)){
+        depart += reorder_gap_us;
+        stats[dir].reordered++;
+    } else {
+        // jitter delays the queue behind a late datagram, it doesn't reorder
+        if(depart <= last_departure_us[dir]) depart = last_departure_us[dir] + 1;
+        last_departure_us[dir] = depart;
+    }
+
+    struct delayed *d = num_delayed < MAX_QUEUED ? malloc(sizeof(*d) + len) : NULL;
+    if(d == NULL){
+        stats[dir].overflowed++;
+        return;
+    }
+    d->sockfd = sockfd;
+    d->to = *to;
+    d->dir = dir;
+    d->len = len;
+    memcpy(d->data, data, len);
+    if(timer_heap_push(&departures, depart, (long long)(intptr_t)d) == 0){
+        free(d);
+        stats[dir].overflowed++;
+        return;
+    }
+    num_delayed++;
+}
+
+/*
+@brief applies the impairments to one received datagram
+
+@param dir: the way it is going
+@param sockfd: the socket to send it from
+@param to: where to send it
+@param data: the datagram
+@param len: its length
+*/
+void impair(enum direction dir, int sockfd, const struct sockaddr_in *to, const char *data, size_t len){
+    static char damaged[MAX_DATAGRAM];
+    uint64_t now = monotonic_us();
+    stats[dir].received++;
+    if(chance(loss)){
+        stats[dir].lost++;
+        return;
+    }
+    if(len > 0 && chance(corrupt)){
+        stats[dir].corrupted++;
+        memcpy(damaged, data, len);
+        damaged[(size_t)(random_unit() * len)] ^= 1 << (int)(random_unit() * 8);
+        data = damaged;
+    }
+    schedule(dir, sockfd, to, data, len, now);
+    if(chance(duplicate)){
+        stats[dir].duplicated++;
+        schedule(dir, sockfd, to, data, len, now);
+    }
+}
+
+/*
+@brief sends every datagram whose departure time has come
+
+@return microseconds until the next departure, -1 if nothing is waiting
+*/
+long long send_due(void){
+    struct timer_entry next;
+    while(timer_heap_peek(&departures, &next)){
+        uint64_t now = monotonic_us();
+        if(next.deadline_us > now) return next.deadline_us - now;
+        timer_heap_pop(&departures, NULL);
+        struct delayed *d = (struct delayed *)(intptr_t)next.key;
+        if(sendto(d->sockfd, d->data, d->len, 0, (const struct sockaddr *)&d->to, sizeof(d->to)) >= 0){
+            stats[d->dir].forwarded++;
+        }
+        free(d);
+        num_delayed--;
+    }
+    return -1;
+}
+
+/*
+@brief reads every datagram waiting on a socket and impairs it
+
+@param sockfd: the listening socket, or a client's socket towards the target
+*/
+void drain(int sockfd){
+    static char buffer[MAX_DATAGRAM];
+    while(1){
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t len = recvfrom(sockfd, buffer, sizeof(buffer), MSG_DONTWAIT, (struct sockaddr *)&from, &from_len);
+        if(len < 0){
+            if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("recvfrom failed");
+            return;
+        }
+        if(sockfd == listen_fd){
+            struct client *c = find_client(&from);
+            if(c == NULL) continue;
+            c->last_heard_us = monotonic_us();
+            impair(FORWARD, c->sockfd, &target, buffer, len);
+        } else {
+            struct client *c = client_by_socket(sockfd);
+            if(c == NULL) continue;
+            impair(REVERSE, listen_fd, &c->addr, buffer, len);
+        }
+    }
+}
+
+/*
+@brief prints what was done to each direction
+
+@param out: where to print
+*/
+void print_stats(FILE *out){
+    const char *names[2] = {"forward", "reverse"};
+    for(int i = 0; i < 2; i++){
+        fprintf(out, "%s: received %llu, forwarded %llu, lost %llu, duplicated %llu, corrupted %llu, reordered %llu, overflowed %llu\n",
+                names[i], stats[i].received, stats[i].forwarded, stats[i].lost, stats[i].duplicated, stats[i].corrupted,
+                stats[i].reordered, stats[i].overflowed);
+    }
+}
+
+/*
+@brief handles SIGINT and SIGTERM: the proxy prints its counters and exits
+
+@param sig: the signal
+*/
+void stop_proxy(int sig){
+    (void)sig;
+    stopping = 1;
+}
+
+/*
+@brief forwards datagrams both ways until interrupted
+
+@return 0 in case of failure, 1 in case of success
+*/
+int proxy(void){
+    struct pollfd pfds[MAX_CLIENTS + 1];
+    while(!stopping){
+        long long wait_us = send_due();
+        pfds[0].fd = listen_fd;
+        pfds[0].events = POLLIN;
+        for(int i = 0; i < num_clients; i++){
+            pfds[i + 1].fd = clients[i].sockfd;
+            pfds[i + 1].events = POLLIN;
+        }
+        struct timespec ts;
+        struct timespec *tsp = NULL;
+        if(wait_us >= 0){
+            ts.tv_sec = wait_us / 1000000LL;
+            ts.tv_nsec = (wait_us % 1000000LL) * 1000;
+            tsp = &ts;
+        }
+        int polled = num_clients + 1;
+        int ready = ppoll(pfds, polled, tsp, NULL);
+        if(ready < 0){
+            if(errno == EINTR) continue;
+            perror("ppoll failed");
+            return 0;
+        }
+        for(int i = 0; i < polled && ready > 0; i++){
+            if(pfds[i].revents & POLLIN) drain(pfds[i].fd);
+        }
+    }
+    return 1;
+}
+
+/*
+@brief prints the command line usage and exits
+
+@param prog: the program name
+*/
+void usage(const char* prog) {
+    fprintf(stderr, "usage: %s [-l loss_%%] [-u duplicate_%%] [-c corrupt_%%] [-o reorder_%%] [-g reorder_gap_us] [-d delay_ms] [-j jitter_ms] [-b bytes_per_sec] [-q queue_bytes] [-s seed] listen_port target_host target_port\n", prog);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "l:u:c:o:g:d:j:b:q:s:")) != -1) {
+        switch (opt) {
+            case 'l':
+                loss = strtod(optarg, NULL);
+                break;
+            case 'u':
+                duplicate = strtod(optarg, NULL);
+                break;
+            case 'c':
+                corrupt = strtod(optarg, NULL);
+                break;
+            case 'o':
+                reorder = strtod(optarg, NULL);
+                break;
+            case 'g':
+                reorder_gap_us = strtoull(optarg, NULL, 10);
+                break;
+            case 'd':
+                delay_us = strtod(optarg, NULL) * 1000.0;
+                break;
+            case 'j':
+                jitter_us = strtod(optarg, NULL) * 1000.0;
+                break;
+            case 'b':
+                rate = strtoull(optarg, NULL, 10);
+                break;
+            case 'q':
+                queue_bytes = strtoull(optarg, NULL, 10);
+                break;
+            case 's':
+                rng_state = strtoull(optarg, NULL, 10);
+                if (rng_state == 0) rng_state = 1;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (argc - optind != 3) {
+        usage(argv[0]);
+    }
+
+    memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_port = htons((unsigned short int)atoi(argv[optind + 2]));
+    if (inet_pton(AF_INET, argv[optind + 1], &target.sin_addr) <= 0) {
+        perror("Invalid address/ Address not supported");
+        exit(EXIT_FAILURE);
+    }
+
+    struct sockaddr_in my_addr;
+    memset(&my_addr, 0, sizeof(my_addr));
+    my_addr.sin_family = AF_INET;
+    my_addr.sin_addr.s_addr = INADDR_ANY;
+    my_addr.sin_port = htons((unsigned short int)atoi(argv[optind]));
+    listen_fd = open_socket();
+    if (listen_fd < 0 || bind(listen_fd, (const struct sockaddr *)&my_addr, sizeof(my_addr)) < 0) {
+        perror("bind failed");
+        exit(EXIT_FAILURE);
+    }
+    if (timer_heap_init(&departures, 1024) == 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    // no SA_RESTART, the signal has to wake ppoll
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_proxy;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    int ok = proxy();
+    print_stats(stderr);
+    for (int i = 0; i < num_clients; i++) close(clients[i].sockfd);
+    close(listen_fd);
+    timer_heap_free(&departures);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,69 @@
+/*
+@file pacing.c
+@brief spreads the sender's window across the round trip instead of bursting it
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include <sys/socket.h>
+
+#include "pacing.h"
+
+/*
+@brief the bucket size for a rate: a millisecond of it, within a few packets
+
+@param p: the pacer
+@param rate: bytes per second
+
+@return the burst in bytes
+*/
+static double pacer_quantum(const struct pacer *p, uint64_t rate){
+    double quantum = (double)rate * PACING_QUANTUM_US / 1e6;
+    if(quantum < PACING_MIN_QUANTUM * (double)p->packet_bytes) quantum = PACING_MIN_QUANTUM * (double)p->packet_bytes;
+    if(quantum > PACING_MAX_QUANTUM * (double)p->packet_bytes) quantum = PACING_MAX_QUANTUM * (double)p->packet_bytes;
+    return quantum;
+}
+
+void pacer_init(struct pacer *p, enum pacing_mode mode, uint64_t fixed_rate, size_t packet_bytes, int sockfd){
+    p->mode = mode;
+    p->fixed_rate = fixed_rate;
+    p->packet_bytes = packet_bytes;
+    p->rate = mode == PACING_FIXED ? fixed_rate : 0;
+    p->kernel = 0;
+    token_bucket_init(&p->bucket, p->rate, pacer_quantum(p, p->rate));
+#ifdef SO_MAX_PACING_RATE
+    if(mode == PACING_FIXED){
+        // the option is 32 bits wide on older kernels, ~0U means no cap
+        unsigned int cap = fixed_rate < 0xffffffffULL ? (unsigned int)fixed_rate : ~0U;
+        p->kernel = setsockopt(sockfd, SOL_SOCKET, SO_MAX_PACING_RATE, &cap, sizeof(cap)) == 0;
+    }
+#else
+    (void)sockfd;
+#endif
+}
+
+void pacer_update(struct pacer *p, const struct congestion *cc, uint64_t srtt_us){
+    if(p->mode != PACING_CWND) return;
+    // packets per second: the controller's own rate if it has one, else the window over the RTT
+    double pps = cc_pacing_rate(cc);
+    if(pps <= 0 && srtt_us > 0){
+        double gain = cc->cwnd < cc->ssthresh ? PACING_GAIN_SS : PACING_GAIN_CA;
+        pps = gain * cc_window(cc) * 1e6 / srtt_us;
+    }
+    uint64_t rate = pps > 0 ? (uint64_t)(pps * p->packet_bytes) : 0;
+    if(rate == p->rate) return;
+    p->rate = rate;
+    token_bucket_set_rate(&p->bucket, rate, pacer_quantum(p, rate));
+}
+
+uint64_t pacer_delay(struct pacer *p){
+    if(p->mode == PACING_OFF) return 0;
+    return token_bucket_delay(&p->bucket);
+}
+
+void pacer_on_send(struct pacer *p, size_t bytes){
+    if(p->mode == PACING_OFF) return;
+    token_bucket_take(&p->bucket, bytes);
+}
@@ -0,0 +1,86 @@
+/*
+@file pacing.h
+@brief spreads the sender's window across the round trip instead of bursting it
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef PACING_H
+#define PACING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "congestion.h"
+#include "token_bucket.h"
+
+#define PACING_GAIN_SS 2.0          // slow start doubles per round, pace ahead of it
+#define PACING_GAIN_CA 1.2          // as Linux, leave room for the window to grow
+#define PACING_QUANTUM_US 1000      // most of the rate released back to back
+#define PACING_MIN_QUANTUM 2        // packets, so acks can still clock out pairs
+#define PACING_MAX_QUANTUM 64       // packets, a GSO super-buffer at most
+
+/*
+@brief how the sending rate is chosen
+*/
+enum pacing_mode {
+    PACING_OFF,
+    PACING_CWND,        // the controller's rate, or cwnd / srtt
+    PACING_FIXED        // a rate given on the command line
+};
+
+/*
+@brief pacer state, a token bucket counted in bytes
+*/
+struct pacer {
+    enum pacing_mode mode;
+    uint64_t fixed_rate;        // bytes per second, for PACING_FIXED
+    size_t packet_bytes;        // a full datagram on the wire
+    uint64_t rate;              // the rate in use, 0 until there is one
+    int kernel;                 // 1 if SO_MAX_PACING_RATE was accepted
+    struct token_bucket bucket;
+};
+
+/*
+@brief initializes a pacer
+
+With a fixed rate, SO_MAX_PACING_RATE is set on the socket as well, so
+an fq qdisc enforces the same cap below the batch layer.
+
+@param p: the pacer
+@param mode: how to choose the rate
+@param fixed_rate: bytes per second, for PACING_FIXED
+@param packet_bytes: a full datagram on the wire
+@param sockfd: the sending socket
+*/
+void pacer_init(struct pacer *p, enum pacing_mode mode, uint64_t fixed_rate, size_t packet_bytes, int sockfd);
+
+/*
+@brief recomputes the rate from the congestion state
+
+@param p: the pacer
+@param cc: the congestion controller
+@param srtt_us: the smoothed RTT, 0 before the first sample
+*/
+void pacer_update(struct pacer *p, const struct congestion *cc, uint64_t srtt_us);
+
+/*
+@brief how long the next packet has to wait
+
+@param p: the pacer
+
+@return nanoseconds until it may leave, 0 if it may leave now
+*/
+uint64_t pacer_delay(struct pacer *p);
+
+/*
+@brief charges a sent datagram to the pacer
+
+@param p: the pacer
+@param bytes: its length on the wire
+*/
+void pacer_on_send(struct pacer *p, size_t bytes);
+
+#endif
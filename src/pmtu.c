@@ -0,0 +1,152 @@
+/*
+@file pmtu.c
+@brief packetization layer path MTU discovery (in the spirit of RFC 8899)
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#define _GNU_SOURCE // for ppoll
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "crc32c.h"
+#include "pmtu.h"
+#include "protocol.h"
+#include "rtt.h"
+
+// common link MTUs, probed below the largest candidate: jumbo, 4K, Ethernet, tunnels, IPv6 minimum
+static const int mtu_plateaus[] = {9000, 4096, 1500, 1400, 1280};
+
+int pmtu_route_payload(const struct sockaddr_in *peer){
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(fd < 0) return DATA_SIZE;
+    int payload = DATA_SIZE;
+    // a connected socket reports the MTU of its route, nothing is sent
+    if(connect(fd, (const struct sockaddr *)peer, sizeof(*peer)) == 0){
+        int mtu;
+        socklen_t len = sizeof(mtu);
+        if(getsockopt(fd, IPPROTO_IP, IP_MTU, &mtu, &len) == 0 && mtu - HEADERS_SIZE > DATA_SIZE){
+            payload = mtu - HEADERS_SIZE;
+        }
+    }
+    close(fd);
+    return payload;
+}
+
+/*
+@brief sets the socket's IP_MTU_DISCOVER policy
+
+@param sockfd: socket information
+@param mode: IP_PMTUDISC_PROBE, IP_PMTUDISC_WANT, ...
+*/
+static void set_pmtu_mode(int sockfd, int mode){
+    if(setsockopt(sockfd, IPPROTO_IP, IP_MTU_DISCOVER, &mode, sizeof(mode)) < 0){
+        perror("failed to set IP_MTU_DISCOVER");
+    }
+}
+
+int pmtu_search_init(struct pmtu_search *search, int sockfd, int max_payload){
+    search->count = 0;
+    search->best = DATA_SIZE;
+    search->probe = NULL;
+    if(max_payload <= DATA_SIZE) return 0;
+
+    search->candidates[search->count++] = max_payload;
+    for(size_t i = 0; i < sizeof(mtu_plateaus) / sizeof(mtu_plateaus[0]) && search->count < PMTU_MAX_CANDIDATES; i++){
+        int payload = mtu_plateaus[i] - HEADERS_SIZE;
+        if(payload < max_payload && payload > DATA_SIZE) search->candidates[search->count++] = payload;
+    }
+    search->probe = calloc(1, sizeof(struct packet_header) + max_payload);
+    if(search->probe == NULL){
+        perror("pmtu probe malloc failed");
+        return 0;
+    }
+    // DF set and no local fragmentation, so a probe either arrives whole or not at all
+    set_pmtu_mode(sockfd, IP_PMTUDISC_PROBE);
+    return 1;
+}
+
+void pmtu_search_send(struct pmtu_search *search, int sockfd, const struct sockaddr_in *peer, int conn_id){
+    for(int i = 0; i < search->count; i++){
+        struct packet_header hdr;
+        hdr.seq_num = -4;
+        hdr.data_len = search->candidates[i];
+        hdr.conn_id = conn_id;
+        hdr.crc = 0;
+        memcpy(search->probe, &hdr, sizeof(hdr));
+        hdr.crc = crc32c_control(search->probe, sizeof(hdr) + search->candidates[i]);
+        memcpy(search->probe, &hdr, sizeof(hdr));
+        // EMSGSIZE just means the local interface can't send it, the probe counts as lost
+        sendto(sockfd, search->probe, sizeof(hdr) + search->candidates[i], 0, (const struct sockaddr *)peer, sizeof(*peer));
+    }
+}
+
+int pmtu_search_echo(struct pmtu_search *search, const void *datagram, size_t len){
+    struct packet_header echo;
+    if(len != sizeof(echo)) return 0;
+    memcpy(&echo, datagram, sizeof(echo));
+    if(echo.seq_num != -4 || crc32c_control(&echo, sizeof(echo)) != echo.crc) return 0;
+    if(search->count > 0 && echo.data_len > search->best && echo.data_len <= search->candidates[0]){
+        search->best = echo.data_len;
+    }
+    return 1;
+}
+
+int pmtu_search_done(const struct pmtu_search *search){
+    return search->count == 0 || search->best >= search->candidates[0];
+}
+
+void pmtu_search_free(struct pmtu_search *search, int sockfd){
+    if(search->probe == NULL) return;
+    // data keeps the default policy, so a later drop in the path MTU fragments instead of failing
+    set_pmtu_mode(sockfd, IP_PMTUDISC_WANT);
+    free(search->probe);
+    search->probe = NULL;
+}
+
+/*
+@brief waits for probe echoes until the deadline or the largest one
+
+@param sockfd: socket information
+@param search: the search
+@param deadline_us: when to stop waiting
+*/
+static void collect_echoes(int sockfd, struct pmtu_search *search, uint64_t deadline_us){
+    while(!pmtu_search_done(search)){
+        uint64_t now = monotonic_us();
+        if(now >= deadline_us) break;
+        struct timespec ts;
+        ts.tv_sec = (deadline_us - now) / 1000000ULL;
+        ts.tv_nsec = ((deadline_us - now) % 1000000ULL) * 1000;
+        struct pollfd pfd;
+        pfd.fd = sockfd;
+        pfd.events = POLLIN;
+        if(ppoll(&pfd, 1, &ts, NULL) <= 0) break;
+
+        // anything else, like a resent SYN-ACK, is dropped here and handled by its resend
+        struct packet_header echo;
+        ssize_t n = recvfrom(sockfd, &echo, sizeof(echo), MSG_DONTWAIT, NULL, NULL);
+        if(n > 0) pmtu_search_echo(search, &echo, n);
+    }
+}
+
+int pmtu_discover(int sockfd, const struct sockaddr_in *peer, int max_payload, uint64_t srtt_us, int conn_id){
+    struct pmtu_search search;
+    if(pmtu_search_init(&search, sockfd, max_payload) == 0) return DATA_SIZE;
+
+    uint64_t wait_us = srtt_us > 0 ? 2 * srtt_us + RTO_GRANULARITY_US : RTO_INITIAL_US / 4;
+    for(int round = 0; round < PMTU_PROBE_ROUNDS && search.best == DATA_SIZE; round++, wait_us *= 2){
+        pmtu_search_send(&search, sockfd, peer, conn_id);
+        collect_echoes(sockfd, &search, monotonic_us() + wait_us);
+    }
+    int best = search.best;
+    pmtu_search_free(&search, sockfd);
+    return best;
+}
@@ -0,0 +1,111 @@
+/*
+@file pmtu.h
+@brief packetization layer path MTU discovery (in the spirit of RFC 8899)
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef PMTU_H
+#define PMTU_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+
+#define PMTU_PROBE_ROUNDS 3     // rounds of probes before settling for DATA_SIZE
+#define PMTU_MAX_CANDIDATES 8
+
+/*
+@brief the largest payload the local route to a peer can carry
+
+@param peer: the peer
+
+@return the payload in bytes from the route's MTU, at least DATA_SIZE
+*/
+int pmtu_route_payload(const struct sockaddr_in *peer);
+
+/*
+@brief one search for the largest payload that reaches a peer
+
+Every candidate size, from the largest payload down through the common
+MTU plateaus, is probed at once with the don't fragment bit set and no
+local fragmentation. The largest size the peer echoes wins. The sender
+sends the probes right behind its SYN and takes in the echoes along
+with the SYN-ACK, so the search costs no round trip of its own.
+*/
+struct pmtu_search {
+    int candidates[PMTU_MAX_CANDIDATES];    // largest first
+    int count;
+    int best;                               // the largest payload echoed so far
+    char *probe;
+};
+
+/*
+@brief starts a search, the socket stops fragmenting until pmtu_search_free()
+
+@param search: the search
+@param sockfd: socket information
+@param max_payload: the largest payload to probe
+
+@return 0 if there's nothing to probe past DATA_SIZE or in case of failure, 1 otherwise
+*/
+int pmtu_search_init(struct pmtu_search *search, int sockfd, int max_payload);
+
+/*
+@brief sends a probe of every candidate size
+
+@param search: the search
+@param sockfd: socket information
+@param peer: the peer, which must echo probes
+@param conn_id: the connection ID the probes carry, 0 before the SYN-ACK
+*/
+void pmtu_search_send(struct pmtu_search *search, int sockfd, const struct sockaddr_in *peer, int conn_id);
+
+/*
+@brief takes in a datagram that may be a probe's echo
+
+@param search: the search
+@param datagram: the datagram
+@param len: its length
+
+@return 1 if it was an echo, 0 otherwise
+*/
+int pmtu_search_echo(struct pmtu_search *search, const void *datagram, size_t len);
+
+/*
+@brief tells whether the largest candidate was echoed, so waiting for more won't help
+
+@param search: the search
+
+@return 1 if the search is over, 0 otherwise
+*/
+int pmtu_search_done(const struct pmtu_search *search);
+
+/*
+@brief ends a search, the socket goes back to the default fragmentation policy
+
+@param search: the search
+@param sockfd: socket information
+*/
+void pmtu_search_free(struct pmtu_search *search, int sockfd);
+
+/*
+@brief finds the largest payload that reaches the peer, in rounds of probes until one is echoed
+
+The search of struct pmtu_search, on its own: it costs a single round
+trip unless every probe is lost. The sender falls back on it when none
+of the probes that went with the SYN were echoed.
+
+@param sockfd: socket information
+@param peer: the peer, which must echo probes
+@param max_payload: the largest payload both ends accept
+@param srtt_us: the RTT measured so far, 0 if unknown
+@param conn_id: the connection ID the probes carry
+
+@return the payload size to use, DATA_SIZE if nothing larger got through
+*/
+int pmtu_discover(int sockfd, const struct sockaddr_in *peer, int max_payload, uint64_t srtt_us, int conn_id);
+
+#endif
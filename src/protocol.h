@@ -0,0 +1,177 @@
+/*
+@file protocol.h
+@brief wire formats shared by the sender and the receiver
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#define DATA_SIZE 508        // payload every IPv4 path carries, the handshake size
+#define BUFFER_SIZE 528
+#define MAX_DATA_SIZE 8960   // payload filling a 9000 byte jumbo frame
+#define HEADERS_SIZE 44      // IPv4, UDP and struct packet_header in front of a payload
+#define MAX_SACK_BLOCKS 8
+
+// data sequence numbers go on the wire modulo 2^SEQ_BITS, which keeps
+// them non-negative so the control values below stay unambiguous.
+// Build with a small -DSEQ_BITS to exercise wraparound
+#ifndef SEQ_BITS
+#define SEQ_BITS 31
+#endif
+#define SEQ_SPACE (1LL << SEQ_BITS)
+
+/*
+@brief the wire form of a sequence number
+
+@param seq: the full 64-bit sequence number
+
+@return seq modulo 2^SEQ_BITS
+*/
+static inline int seq_wire(long long seq){
+    return (int)(seq & (SEQ_SPACE - 1));
+}
+
+/*
+@brief recovers a full sequence number from its wire form
+
+Serial number arithmetic (RFC 1982): the wire value is taken to be
+the one within half the sequence space of ref, so comparisons on the
+result are plain 64-bit comparisons that never wrap. Windows are far
+smaller than half the space, so ref is always close enough.
+
+@param wire: the sequence number as received
+@param ref: a nearby full sequence number, e.g. the window's base
+
+@return the full sequence number
+*/
+static inline long long seq_unwrap(int wire, long long ref){
+    long long diff = ((long long)wire - ref) & (SEQ_SPACE - 1);
+    if(diff >= SEQ_SPACE / 2) diff -= SEQ_SPACE;
+    return ref + diff;
+}
+
+/*
+@brief packet structure, used to serialize and deserialize data packets
+
+A data packet's seq_num is its sequence number's wire form, see
+seq_wire(). seq_num -1 is the handshake (SYN / SYN-ACK), -2 ends the transfer early
+and -3 is a header-only probe asking for an ack while the receive window
+is closed. The SYN's data is the transfer length, the sender's largest
+payload, where in the file the data goes, the whole file's length (0 if
+unknown), the parity block size (0 for none), 1 to offer compression,
+the file's modification time in nanoseconds (0 if unknown) and the
+file's name. The SYN-ACK's is the initial receive window, the largest
+payload both ends accept, the parity block size the receiver accepts,
+1 if it takes compressed blocks and how many bytes at the start of the
+range it already has from an interrupted transfer of the same file.
+The data then starts that far into the range.
+
+The SYN's acked counts the SYNs sent, the SYN-ACK's names the SYN it
+answers, or is -1 for a resend on the receiver's own timer. A SYN
+offering no more than DATA_SIZE opens the session at once, with no
+handshake ack to wait for.
+
+conn_id is the connection ID the receiver hands out in the SYN-ACK, so
+one receiver port can tell many senders apart. The SYN carries 0, and
+so does whatever the sender sends before the SYN-ACK: the path MTU
+probes right behind the SYN and a small transfer's data. The receiver
+takes those by the sender's address. Every later datagram in either
+direction carries the ID.
+*/
+struct packet {
+    int seq_num;
+    int data_len;
+    int conn_id;
+    unsigned int crc;
+    char data[DATA_SIZE];
+    int acked;
+};
+
+/*
+@brief header in front of every data packet's payload
+
+A data packet is this header followed by exactly data_len bytes, at
+most the payload size negotiated in the handshake. It is laid out like
+the start of struct packet. crc is the CRC32C of the payload extended
+over the header with crc itself taken as 0, see crc32c_packet(). The
+receiver drops a data or parity packet that doesn't match, so it is
+resent like a lost one. Every other datagram, acks included, carries
+crc32c_control() of itself in a crc field at this same offset, and is
+dropped too when that doesn't match.
+
+A path MTU probe has seq_num -4 and data_len bytes of padding, the
+receiver echoes just its header back to show that size got through.
+A parity packet has seq_num -5, see struct fec_header. Once every
+packet is acked the sender sends seq_num -6 with 4 bytes of data, the
+CRC32C of all the bytes it sent; the receiver answers with the same
+packet carrying its own.
+*/
+struct packet_header {
+    int seq_num;
+    int data_len;
+    int conn_id;
+    unsigned int crc;
+};
+
+/*
+@brief what a parity packet covers, between its packet_header and its data_len bytes of parity
+
+The parity is the XOR of the block's payloads, each padded with zeros
+to the longest. first_seq is the block's first packet in wire form,
+count how many consecutive packets it covers and len_xor their
+data_len values XORed, so a rebuilt packet gets its length back. The
+SYN offers the block size and the SYN-ACK accepts it or turns it off.
+*/
+struct fec_header {
+    int first_seq;
+    int count;
+    int len_xor;
+};
+
+/*
+@brief starts every block of a compressed transfer
+
+When the handshake turns compression on, the data packets no longer
+carry the file's bytes but a stream of blocks, each this header and
+stored_len bytes. A block holds raw_len bytes of the file, LZ
+compressed, or stored as is when stored_len equals raw_len because
+they didn't compress. Blocks run across packet boundaries.
+*/
+struct block_header {
+    int raw_len;
+    int stored_len;
+};
+
+/*
+@brief a run of received sequence numbers [start, end) past a gap
+*/
+struct sack_block {
+    int start;
+    int end;
+};
+
+/*
+@brief ack packet structure, used to serialize and deserialize acks
+
+seq_num is cumulative: every packet below it has been received. Like
+the sack blocks it is in wire form, see seq_wire(). The
+sender's handshake ack uses -1 and puts the payload size it picked in
+window. Otherwise window is the receive window: the sender may send
+sequence numbers below seq_num + window. The sack
+blocks list packets received past the first gap, lowest first.
+conn_id and crc sit at the same offsets as in every other datagram.
+*/
+struct ack_packet {
+    int seq_num;
+    int window;
+    int conn_id;
+    unsigned int crc;
+    int num_sacks;
+    struct sack_block sacks[MAX_SACK_BLOCKS];
+};
+
+#endif
@@ -0,0 +1,298 @@
+/*
+@file rdt.h
+@brief librdt: reliable transfers over UDP, for programs that embed them
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef RDT_H
+#define RDT_H
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <netinet/in.h>
+
+#include "batch_io.h"
+#include "congestion.h"
+#include "compress.h"
+#include "crc32c.h"
+#include "endpoint.h"
+#include "fec.h"
+#include "pacing.h"
+#include "protocol.h"
+#include "rtt.h"
+#include "send_window.h"
+#include "session.h"
+#include "telemetry.h"
+#include "timer_heap.h"
+
+#define RDT_WINDOW 32768                // default send window capacity in packets
+#define RDT_REORDER_SIZE 32768          // default packets accepted past a gap, matches the sender's window
+#define RDT_ACK_EVERY 2                 // in order packets covered by one ack
+#define RDT_ACK_DELAY_US 500            // longest an in order packet waits for its ack, well under RTO_MIN_US
+#define RDT_MAX_PORTS 64                // consecutive ports one receiver listens on
+#define RDT_MAX_SESSIONS (1 << 16)      // the slot part of a connection ID
+#define RDT_PROBE_MAX_US 1000000ULL     // longest gap between zero window probes
+#define RDT_DIGEST_TRIES 4              // digest packets sent before giving up on the receiver's answer
+#define RDT_EARLY_PACKETS CC_INIT_CWND  // a transfer of up to this many DATA_SIZE packets goes out with its SYN
+
+/*
+@brief how a sender runs, see rdt_send_config_default()
+*/
+struct rdt_send_config {
+    enum cc_algorithm cc_algo;
+    enum pacing_mode pacing_mode;
+    uint64_t pacing_rate;               // bytes/s for PACING_FIXED
+    int window_capacity;                // most packets in flight
+    int max_payload;
+    int batch_size;
+    int use_gso;
+    unsigned long long range_offset;    // where in the receiver's file the data goes
+    unsigned long long file_length;     // the whole file's length, 0 to work it out or leave it unknown
+    const char *name;                   // the data's name for the receiver, may be NULL
+    int fec_k;                          // data packets per parity packet, 0 for none
+    int compress;                       // 1 to offer LZ compressed blocks
+    struct telemetry *telemetry;        // where samples go, NULL for none
+};
+
+/*
+@brief what one transfer did, see rdt_send_print_stats()
+*/
+struct rdt_send_stats {
+    unsigned long long packets_sent;    // data packets, each counted once
+    unsigned long long retransmits;     // resends after a timeout or a fast retransmit
+    unsigned long long fast_retransmits;
+    unsigned long long timeouts;        // RTO backoffs, one per loss event
+    unsigned long long acks;
+    unsigned long long dup_acks;        // acks that covered nothing new
+    unsigned long long probes;          // zero window probes
+    unsigned long long parity_sent;     // parity packets, one per block of fec_k
+    unsigned long long bytes_acked;
+    int cwnd_max;
+    struct histogram rtt;               // every RTT sample, in microseconds
+    uint64_t started_us;
+    uint64_t finished_us;
+};
+
+/*
+@brief everything one sender needs, so a process can run any number of them
+
+Fill in config, then call rdt_send() for each transfer. The rest is
+the state of the transfer in progress, and its outcome once
+rdt_send() returns.
+*/
+struct rdt_sender {
+    struct rdt_send_config config;
+    int sockfd;
+    struct sockaddr_in peer;
+    struct rdt_source source;
+    const char *map;                    // the data, when it can be sent straight from memory
+    size_t map_len;
+    int owns_map;                       // 1 if map is our mmap of the source's file
+    char *staging;                      // one payload read ahead from a pipe or callback
+    size_t staged;                      // bytes waiting in staging
+    long long rwnd_edge;                // the receive window: sequence numbers below it may be sent
+    long long rwnd_ack;                 // the cumulative ack the window was advertised with
+    uint64_t probe_deadline_us;
+    uint64_t probe_interval_us;
+    int payload_size;                   // negotiated in the handshake
+    int conn_id;                        // handed out by the receiver in the SYN-ACK, 0 until then
+    struct packet syn;
+    int syns_sent;
+    uint64_t syn_sent_us[RTO_MAX_RETRIES + 1];  // when each SYN went out, the SYN-ACK names the one it answers
+    int fec_k;                          // the parity block size the receiver accepted, 0 for none
+    struct fec_encoder fec;
+    int compress;                       // 1 if the receiver takes compressed blocks
+    struct compressor compressor;
+    struct ack_packet handshake_ack;
+    long long pack_num;
+    long long highest_acked;
+    long long fast_retransmit_next;
+    uint64_t next_backoff_us;
+    struct congestion cc;
+    struct rtt_estimator rtt;
+    struct timer_heap timers;
+    struct send_window window;
+    struct batch_io batch;
+    struct pacer pacer;
+    unsigned long long bytes_total;     // what the SYN announced
+    unsigned long long bytes_sent;      // resumed bytes included
+    long long mtime;                    // the source file's modification time in nanoseconds, 0 if it isn't a file
+    unsigned long long resumed;         // bytes the receiver already had from an earlier try, skipped
+    uint32_t digest;                    // CRC32C of the bytes sent so far
+    struct crc32c_shift shift;          // appends a full payload's CRC to digest
+    int digest_match;                   // 1 if the receiver's digest matched, 0 if not, -1 if it didn't answer
+    int complete;                       // 1 once every byte was sent and acked
+    struct rdt_send_stats stats;
+    uint64_t next_sample_us;
+};
+
+/*
+@brief how a receiver runs, see rdt_recv_config_default()
+*/
+struct rdt_recv_config {
+    struct session_config session;
+    int batch_size;
+    int use_gro;
+    int max_sessions;
+    struct telemetry *telemetry;        // where samples go, NULL for none
+};
+
+/*
+@brief decides where a new transfer's data goes
+
+@param arg: the argument given to rdt_serve()
+@param transfer: what the sender asked for
+@param sink: where to store the sink for it
+
+@return 1 to accept the transfer, 0 to ignore the sender
+*/
+typedef int (*rdt_accept_fn)(void *arg, const struct rdt_transfer *transfer, struct rdt_sink *sink);
+
+/*
+@brief called once a transfer is over, its sink is no longer used after this
+
+@param arg: the argument given to rdt_serve()
+@param transfer: the transfer, with its totals
+@param sink: the sink accept gave it
+@param ok: 1 if every byte arrived and was stored, 0 otherwise
+*/
+typedef void (*rdt_finish_fn)(void *arg, const struct rdt_transfer *transfer, struct rdt_sink *sink, int ok);
+
+/*
+@brief a socket a receiver serves transfers on
+*/
+struct rdt_listener {
+    int sockfd;
+    struct batch_io batch;
+};
+
+/*
+@brief everything one receiver needs, so a process can run any number of them
+
+Sessions are found by connection ID: the ID is a slot in sessions and
+the slot's generation, so a lookup is one index and a stale ID from an
+earlier session in the same slot doesn't match. What a sender sends
+before it has its ID is matched by address in the peers hash.
+*/
+struct rdt_receiver {
+    struct rdt_recv_config config;
+    struct rdt_listener listeners[RDT_MAX_PORTS];
+    int num_listeners;
+    int epoll_fd;
+    int wake_fd;                        // an eventfd that rdt_receiver_stop() writes
+    volatile sig_atomic_t stopping;
+    struct session **sessions;
+    unsigned short *generations;        // bumped every time a slot is reused
+    int active_sessions;
+    int next_slot;
+    struct session **peers;             // 1 << peer_bits buckets, chained through peer_next
+    int peer_bits;
+    struct timer_heap timers;
+    uint64_t next_sample_us;
+    int ack_list[MAX_BATCH_SIZE];       // connection IDs owed an ack once the batch is handled
+    int ack_count;
+    int once;                           // stop after the first transfer
+    int done;
+    rdt_accept_fn accept;
+    rdt_finish_fn finish;
+    void *arg;
+};
+
+/*
+@brief fills in the defaults: CUBIC, no pacing, the largest payload
+
+@param config: the config to fill in
+*/
+void rdt_send_config_default(struct rdt_send_config *config);
+
+/*
+@brief sends one transfer and waits until it is acked or the receiver is gone
+
+@param s: the sender, its config filled in
+@param host: the receiver's IPv4 address
+@param port: the receiver's port
+@param source: where the data comes from
+@param bytes: the most bytes to send, less if the source ends first
+
+@return 1 if every byte was acked, 0 otherwise
+*/
+int rdt_send(struct rdt_sender *s, const char *host, unsigned short int port, struct rdt_source source, unsigned long long bytes);
+
+/*
+@brief prints the last transfer's counters, RTT percentiles, batching and pacing
+
+@param s: the sender
+@param out: where to print
+*/
+void rdt_send_print_stats(const struct rdt_sender *s, FILE *out);
+
+/*
+@brief fills in the defaults: one session, the usual ack and queue sizes, no caps
+
+@param config: the config to fill in
+*/
+void rdt_recv_config_default(struct rdt_recv_config *config);
+
+/*
+@brief sets up a receiver listening on consecutive ports
+
+@param r: the receiver
+@param config: its settings, copied
+@param port: the first port
+@param ports: how many ports, 1 to RDT_MAX_PORTS
+
+@return 0 in case of failure, 1 in case of success
+*/
+int rdt_receiver_init(struct rdt_receiver *r, const struct rdt_recv_config *config, unsigned short int port, int ports);
+
+/*
+@brief serves transfers until rdt_receiver_stop(), or until the first one is over
+
+@param r: the receiver
+@param accept: picks each new transfer's sink
+@param finish: told when each transfer is over, may be NULL
+@param arg: passed to both
+@param once: 1 to return after the first transfer
+
+@return 0 if the event loop failed, 1 otherwise
+*/
+int rdt_serve(struct rdt_receiver *r, rdt_accept_fn accept, rdt_finish_fn finish, void *arg, int once);
+
+/*
+@brief receives exactly one transfer into a sink
+
+@param r: the receiver
+@param sink: where the data goes
+@param result: where to store the transfer's totals, may be NULL
+
+@return 1 if every byte arrived and was stored, 0 otherwise
+*/
+int rdt_recv(struct rdt_receiver *r, struct rdt_sink sink, struct rdt_transfer *result);
+
+/*
+@brief makes rdt_serve() finish its sessions and return, safe from a signal handler or another thread
+
+@param r: the receiver
+*/
+void rdt_receiver_stop(struct rdt_receiver *r);
+
+/*
+@brief prints each listener's batching counters
+
+@param r: the receiver
+@param out: where to print
+*/
+void rdt_receiver_print_stats(const struct rdt_receiver *r, FILE *out);
+
+/*
+@brief closes the sockets and releases what rdt_receiver_init() set up
+
+@param r: the receiver
+*/
+void rdt_receiver_free(struct rdt_receiver *r);
+
+#endif
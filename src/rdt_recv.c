@@ -0,0 +1,540 @@
+/*
+@file rdt_recv.c
+@brief librdt's receiver: an event loop serving any number of sessions on a few sockets
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#define _GNU_SOURCE // for epoll_pwait2
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+#include "clock.h"
+#include "file_writer.h"
+#include "rdt.h"
+
+#define WAKE_EVENT RDT_MAX_PORTS    // the epoll tag of the wake-up eventfd, past every listener's
+
+void rdt_recv_config_default(struct rdt_recv_config *config){
+    memset(config, 0, sizeof(*config));
+    config->session.reorder_size = RDT_REORDER_SIZE;
+    config->session.ack_every = RDT_ACK_EVERY;
+    config->session.ack_delay_us = RDT_ACK_DELAY_US;
+    config->session.write_queue_size = WRITE_QUEUE_SIZE;
+    config->session.max_payload = MAX_DATA_SIZE;
+    config->batch_size = BATCH_SIZE;
+    config->max_sessions = 1;
+}
+
+/*
+@brief the session a connection ID belongs to
+
+@param r: the receiver
+@param conn_id: the connection ID
+
+@return the session, or NULL if there is none
+*/
+static struct session *find_session(const struct rdt_receiver *r, long long conn_id){
+    int slot = conn_id & (RDT_MAX_SESSIONS - 1);
+    if(conn_id <= 0 || slot >= r->config.max_sessions || r->sessions[slot] == NULL) return NULL;
+    return r->sessions[slot]->info.conn_id == conn_id ? r->sessions[slot] : NULL;
+}
+
+/*
+@brief the peers bucket of an address
+
+@param r: the receiver
+@param peer: the address
+
+@return the bucket's index
+*/
+static unsigned int peer_bucket(const struct rdt_receiver *r, const struct sockaddr_in *peer){
+    uint32_t key = peer->sin_addr.s_addr ^ ((uint32_t)peer->sin_port << 16);
+    return (key * 2654435761u) >> (32 - r->peer_bits);
+}
+
+/*
+@brief the session started by a SYN from this address, for what its sender sent before it had the ID
+
+@param r: the receiver
+@param peer: the sender's address
+
+@return the session, or NULL if there is none
+*/
+static struct session *find_peer(const struct rdt_receiver *r, const struct sockaddr_in *peer){
+    for(struct session *s = r->peers[peer_bucket(r, peer)]; s != NULL; s = s->peer_next){
+        if(s->syn_peer.sin_addr.s_addr == peer->sin_addr.s_addr && s->syn_peer.sin_port == peer->sin_port) return s;
+    }
+    return NULL;
+}
+
+/*
+@brief makes sure the timer heap wakes the loop by the session's next deadline
+
+Entries are never removed, an earlier deadline pushes a new one and the
+loop skips entries that no longer match. A later deadline waits for the
+armed one to fire, so a busy session doesn't push on every packet
+
+@param r: the receiver
+@param s: the session
+*/
+static void arm_timer(struct rdt_receiver *r, struct session *s){
+    uint64_t deadline = session_deadline(s);
+    if(s->timer_us != 0 && s->timer_us <= deadline) return;
+    s->timer_us = deadline;
+    if(timer_heap_push(&r->timers, deadline, s->info.conn_id) == 0){
+        perror("failed to arm session timer");
+    }
+}
+
+/*
+@brief writes a session's counters as one telemetry line
+
+@param r: the receiver
+@param s: the session
+@param now: the current monotonic time in microseconds
+@param summary: 1 for the line written when the session is over, with its outcome
+@param ok: the outcome, for a summary
+*/
+static void emit_stats(struct rdt_receiver *r, const struct session *s, uint64_t now, int summary, int ok){
+    const struct rdt_transfer *info = &s->info;
+    uint64_t end = summary && info->finished_us != 0 ? info->finished_us : now;
+    uint64_t elapsed = end - info->started_us;
+    static const char *states[] = {"handshake", "open", "done"};
+    telemetry_emit(r->config.telemetry, "\"type\":\"%s\",\"side\":\"recv\",\"t_us\":%llu,\"conn_id\":%d,\"state\":\"%s\",%s"
+                   "\"bytes_received\":%llu,\"bytes_expected\":%llu,\"packets\":%llu,\"duplicates\":%llu,"
+                   "\"out_of_order\":%llu,\"reorder\":%d,\"reorder_peak\":%d,\"fec_recovered\":%llu,\"corrupt\":%llu,"
+                   "\"digest_match\":%d,\"goodput_mbps\":%.2f",
+                   summary ? "summary" : "sample", (unsigned long long)elapsed, info->conn_id, states[s->state],
+                   summary ? (ok ? "\"complete\":true," : "\"complete\":false,") : "", info->bytes_received,
+                   info->bytes_expected, info->packets_received, info->duplicates, info->out_of_order,
+                   s->rwnd.count, info->reorder_peak, info->fec_recovered, info->corrupt, info->digest_match, elapsed > 0 ? info->bytes_received * 8.0 / elapsed : 0.0);
+}
+
+/*
+@brief samples every session, if telemetry is on and a sample is due
+
+@param r: the receiver
+@param now: the current monotonic time in microseconds
+*/
+static void sample_sessions(struct rdt_receiver *r, uint64_t now){
+    if(r->config.telemetry == NULL || r->active_sessions == 0 || now < r->next_sample_us) return;
+    r->next_sample_us = now + r->config.telemetry->interval_us;
+    int left = r->active_sessions;
+    for(int i = 0; i < r->config.max_sessions && left > 0; i++){
+        if(r->sessions[i] == NULL) continue;
+        emit_stats(r, r->sessions[i], now, 0, 0);
+        left--;
+    }
+}
+
+/*
+@brief closes a session, reports it and frees its slot
+
+@param r: the receiver
+@param s: the session
+*/
+static void end_session(struct rdt_receiver *r, struct session *s){
+    r->sessions[s->info.conn_id & (RDT_MAX_SESSIONS - 1)] = NULL;
+    struct session **link = &r->peers[peer_bucket(r, &s->syn_peer)];
+    while(*link != s) link = &(*link)->peer_next;
+    *link = s->peer_next;
+    r->active_sessions--;
+    int ok = session_close(s);
+    if(r->config.telemetry != NULL) emit_stats(r, s, monotonic_us(), 1, ok);
+    if(r->finish != NULL) r->finish(r->arg, &s->info, &s->sink, ok);
+    if(r->once) r->done = 1;
+    free(s);
+}
+
+/*
+@brief starts a session for a new sender's SYN
+
+the SYN is ignored when every slot is taken or the owner turns it
+down, the sender backs off and tries again
+
+@param r: the receiver
+@param l: the socket the SYN came in on
+@param data: the SYN
+@param len: its length
+@param from: the sender's address
+*/
+static void start_session(struct rdt_receiver *r, struct rdt_listener *l, const char *data, size_t len, const struct sockaddr_in *from){
+    struct syn_request syn;
+    if(r->active_sessions >= r->config.max_sessions || r->done || session_parse_syn(data, len, &syn) == 0) return;
+    while(r->sessions[r->next_slot] != NULL) r->next_slot = (r->next_slot + 1) % r->config.max_sessions;
+    int slot = r->next_slot;
+    // the generation keeps IDs positive and apart from 0, the SYN's ID
+    unsigned short generation = r->generations[slot] % 0x7fff + 1;
+    int conn_id = (generation << 16) | slot;
+
+    struct rdt_transfer transfer;
+    memset(&transfer, 0, sizeof(transfer));
+    transfer.conn_id = conn_id;
+    transfer.peer = *from;
+    snprintf(transfer.name, sizeof(transfer.name), "%s", syn.name);
+    transfer.offset = syn.offset;
+    transfer.file_length = syn.file_length;
+    transfer.mtime = syn.mtime;
+    transfer.bytes_expected = syn.total;
+    struct rdt_sink sink;
+    if(r->accept(r->arg, &transfer, &sink) == 0) return;
+
+    struct session *s = malloc(sizeof(*s));
+    if(s == NULL || session_init(s, &r->config.session, &l->batch, conn_id, from, &sink, &syn) == 0){
+        if(s == NULL) perror("session malloc failed");
+        free(s);
+        if(r->finish != NULL) r->finish(r->arg, &transfer, &sink, 0);
+        return;
+    }
+    r->generations[slot] = generation;
+    r->sessions[slot] = s;
+    // keyed by the SYN's address, session_handle() follows the peer if it moves
+    s->syn_peer = *from;
+    unsigned int bucket = peer_bucket(r, from);
+    s->peer_next = r->peers[bucket];
+    r->peers[bucket] = s;
+    r->active_sessions++;
+    arm_timer(r, s);
+}
+
+/*
+@brief sends the acks the last batch asked for
+
+a single session is over once everything arrived, it is acked and the
+digests were compared, there's no one else to serve
+
+@param r: the receiver
+*/
+static void send_acks(struct rdt_receiver *r){
+    for(int i = 0; i < r->ack_count; i++){
+        struct session *s = find_session(r, r->ack_list[i]);
+        if(s == NULL) continue;
+        s->ack_queued = 0;
+        session_send_ack(s);
+        if(r->once && s->state == SESSION_DONE && s->info.digest_match >= 0){
+            // the digest answer goes out before closing waits on the disk
+            batch_io_flush(s->batch);
+            end_session(r, s);
+        }
+    }
+    r->ack_count = 0;
+}
+
+/*
+@brief hands one incoming datagram to its session
+
+@param r: the receiver
+@param l: the socket it came in on
+@param data: the datagram
+@param len: the number of bytes received for it
+@param from: the sender's address
+*/
+static void dispatch(struct rdt_receiver *r, struct rdt_listener *l, const char *data, size_t len, const struct sockaddr_in *from){
+    struct packet_header hdr;
+    if(len < sizeof(hdr)) return;
+    memcpy(&hdr, data, sizeof(hdr));
+
+    struct session *s;
+    if(hdr.conn_id == 0){
+        // the SYN comes without an ID, and so does what the sender sends before the SYN-ACK:
+        // resent SYNs, the path MTU probes and a small transfer's data go to the session it started
+        s = find_peer(r, from);
+        if(s == NULL){
+            if(hdr.seq_num == -1 && len > sizeof(struct ack_packet)) start_session(r, l, data, len, from);
+            return;
+        }
+    } else {
+        s = find_session(r, hdr.conn_id);
+        if(s == NULL) return;
+    }
+
+    int result = session_handle(s, data, len, from);
+    if(result < 0){
+        end_session(r, s);
+        return;
+    }
+    // one ack answers the whole batch, it carries every sack block anyway
+    if(result > 0 && !s->ack_queued){
+        // GRO can split a batch into more datagrams than the list holds
+        if(r->ack_count == MAX_BATCH_SIZE) send_acks(r);
+        s->ack_queued = 1;
+        r->ack_list[r->ack_count++] = s->info.conn_id;
+    }
+    arm_timer(r, s);
+}
+
+/*
+@brief runs every session timer that is due
+
+@param r: the receiver
+@param now: the current monotonic time in microseconds
+*/
+static void run_timers(struct rdt_receiver *r, uint64_t now){
+    struct timer_entry next;
+    while(timer_heap_peek(&r->timers, &next) && next.deadline_us <= now){
+        timer_heap_pop(&r->timers, NULL);
+        struct session *s = find_session(r, next.key);
+        if(s == NULL || s->timer_us != next.deadline_us) continue;
+        s->timer_us = 0;
+        if(session_timeout(s, now) < 0){
+            end_session(r, s);
+            continue;
+        }
+        arm_timer(r, s);
+    }
+}
+
+/*
+@brief opens a socket on a port and adds it to the event loop
+
+@param r: the receiver
+@param port: the port to receive on
+
+@return 0 in case of failure, 1 in case of success
+*/
+static int open_listener(struct rdt_receiver *r, unsigned short int port){
+    struct rdt_listener *l = &r->listeners[r->num_listeners];
+    struct sockaddr_in my_addr;
+
+    l->sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (l->sockfd == -1) {
+        perror("socket creation failed");
+        return 0;
+    }
+
+    memset(&my_addr, 0, sizeof(my_addr));
+    my_addr.sin_family = AF_INET;
+    my_addr.sin_addr.s_addr = INADDR_ANY;
+    my_addr.sin_port = htons(port);
+
+    if (bind(l->sockfd, (const struct sockaddr *)&my_addr, sizeof(my_addr)) < 0) {
+        perror("bind failed");
+        close(l->sockfd);
+        return 0;
+    }
+
+    // a parity packet is the largest, a fec_header on top of a full payload
+    size_t max_datagram = sizeof(struct packet_header) + sizeof(struct fec_header) + r->config.session.max_payload;
+    if (batch_io_init(&l->batch, l->sockfd, r->config.batch_size, max_datagram > BUFFER_SIZE ? max_datagram : BUFFER_SIZE) == 0) {
+        close(l->sockfd);
+        return 0;
+    }
+    if (r->config.use_gro && batch_io_enable_gro(&l->batch) == 0) {
+        fprintf(stderr, "UDP GRO is not supported here, receiving one datagram per message\n");
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u32 = r->num_listeners;
+    if (epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, l->sockfd, &ev) < 0) {
+        perror("epoll_ctl failed");
+        batch_io_free(&l->batch);
+        close(l->sockfd);
+        return 0;
+    }
+    r->num_listeners++;
+    return 1;
+}
+
+int rdt_receiver_init(struct rdt_receiver *r, const struct rdt_recv_config *config, unsigned short int port, int ports){
+    memset(r, 0, sizeof(*r));
+    r->config = *config;
+    r->epoll_fd = -1;
+    r->wake_fd = -1;
+    if(ports < 1 || ports > RDT_MAX_PORTS || config->max_sessions < 1 || config->max_sessions > RDT_MAX_SESSIONS){
+        fprintf(stderr, "receiver needs 1 to %d ports and 1 to %d sessions\n", RDT_MAX_PORTS, RDT_MAX_SESSIONS);
+        return 0;
+    }
+    r->sessions = calloc(config->max_sessions, sizeof(*r->sessions));
+    r->generations = calloc(config->max_sessions, sizeof(*r->generations));
+    r->peer_bits = 1;
+    while((1 << r->peer_bits) < config->max_sessions) r->peer_bits++;
+    r->peers = calloc(1 << r->peer_bits, sizeof(*r->peers));
+    r->epoll_fd = epoll_create1(0);
+    r->wake_fd = eventfd(0, EFD_NONBLOCK);
+    int timers_ok = timer_heap_init(&r->timers, config->max_sessions);
+    if(r->sessions == NULL || r->generations == NULL || r->peers == NULL || r->epoll_fd < 0 || r->wake_fd < 0 || timers_ok == 0){
+        perror("receiver setup failed");
+        if(timers_ok) timer_heap_free(&r->timers);
+        rdt_receiver_free(r);
+        return 0;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u32 = WAKE_EVENT;
+    if(epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, r->wake_fd, &ev) < 0){
+        perror("epoll_ctl failed");
+        rdt_receiver_free(r);
+        return 0;
+    }
+    for(int i = 0; i < ports; i++){
+        if(open_listener(r, port + i) == 0){
+            rdt_receiver_free(r);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int rdt_serve(struct rdt_receiver *r, rdt_accept_fn accept, rdt_finish_fn finish, void *arg, int once){
+    r->accept = accept;
+    r->finish = finish;
+    r->arg = arg;
+    r->once = once;
+    r->done = 0;
+    int ok = 1;
+
+    // datagrams are drained a batch at a time from whichever sockets are
+    // readable and handed to their sessions by connection ID. The loop
+    // sleeps until a socket is readable or the earliest session timer, so
+    // idle sessions cost nothing
+    struct epoll_event events[RDT_MAX_PORTS + 1];
+    while(!r->stopping && !r->done){
+        uint64_t now = monotonic_us();
+        run_timers(r, now);
+        sample_sessions(r, now);
+        for(int i = 0; i < r->num_listeners; i++) batch_io_flush(&r->listeners[i].batch);
+        if(r->done) break;
+
+        struct timespec ts;
+        struct timespec *tsp = NULL;
+        struct timer_entry next;
+        int has_timer = timer_heap_peek(&r->timers, &next);
+        // telemetry wakes the loop too, but only while there is something to sample
+        if(r->config.telemetry != NULL && r->active_sessions > 0 && (!has_timer || r->next_sample_us < next.deadline_us)){
+            next.deadline_us = r->next_sample_us;
+            has_timer = 1;
+        }
+        if(has_timer){
+            now = monotonic_us();
+            uint64_t wait_us = next.deadline_us > now ? next.deadline_us - now : 0;
+            ts.tv_sec = wait_us / 1000000ULL;
+            ts.tv_nsec = (wait_us % 1000000ULL) * 1000;
+            tsp = &ts;
+        }
+        int ready = epoll_pwait2(r->epoll_fd, events, RDT_MAX_PORTS + 1, tsp, NULL);
+        if(ready < 0){
+            if(errno == EINTR) continue;
+            perror("epoll_wait failed");
+            ok = 0;
+            break;
+        }
+
+        for(int e = 0; e < ready; e++){
+            if(events[e].data.u32 == WAKE_EVENT){
+                uint64_t count;
+                if(read(r->wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) perror("eventfd read failed");
+                continue;
+            }
+            struct rdt_listener *l = &r->listeners[events[e].data.u32];
+            int count = batch_io_recv(&l->batch, MSG_DONTWAIT);
+            for(int i = 0; i < count; i++){
+                size_t len;
+                struct sockaddr_in from;
+                char *data = batch_io_datagram(&l->batch, i, &len, &from);
+                dispatch(r, l, data, len, &from);
+            }
+            send_acks(r);
+            batch_io_flush(&l->batch);
+        }
+    }
+
+    // don't leave the last packets unacked
+    for(int i = 0; i < r->config.max_sessions; i++){
+        struct session *s = r->sessions[i];
+        if(s == NULL) continue;
+        if(s->unacked_packets > 0) session_send_ack(s);
+        end_session(r, s);
+    }
+    for(int i = 0; i < r->num_listeners; i++) batch_io_flush(&r->listeners[i].batch);
+    return ok;
+}
+
+/*
+@brief the outcome of rdt_recv()'s one transfer
+*/
+struct single_transfer {
+    struct rdt_sink sink;
+    struct rdt_transfer result;
+    int ok;
+};
+
+/*
+@brief accepts the first transfer into rdt_recv()'s sink
+
+@param arg: the struct single_transfer
+@param transfer: unused
+@param sink: where to store the sink
+
+@return 1, always
+*/
+static int accept_single(void *arg, const struct rdt_transfer *transfer, struct rdt_sink *sink){
+    (void)transfer;
+    *sink = ((struct single_transfer *)arg)->sink;
+    return 1;
+}
+
+/*
+@brief keeps the totals of rdt_recv()'s transfer
+
+@param arg: the struct single_transfer
+@param transfer: the transfer
+@param sink: unused
+@param ok: whether it all arrived
+*/
+static void finish_single(void *arg, const struct rdt_transfer *transfer, struct rdt_sink *sink, int ok){
+    (void)sink;
+    struct single_transfer *single = arg;
+    single->result = *transfer;
+    single->ok = ok;
+}
+
+int rdt_recv(struct rdt_receiver *r, struct rdt_sink sink, struct rdt_transfer *result){
+    struct single_transfer single;
+    memset(&single, 0, sizeof(single));
+    single.sink = sink;
+    rdt_serve(r, accept_single, finish_single, &single, 1);
+    if(result != NULL) *result = single.result;
+    return single.ok;
+}
+
+void rdt_receiver_stop(struct rdt_receiver *r){
+    uint64_t one = 1;
+    r->stopping = 1;
+    // write() is async-signal-safe, and wakes a loop blocked in epoll. Its result is
+    // ignored on purpose: it only fails when the eventfd is full, and then a wakeup is pending
+    (void)!write(r->wake_fd, &one, sizeof(one));
+}
+
+void rdt_receiver_print_stats(const struct rdt_receiver *r, FILE *out){
+    for(int i = 0; i < r->num_listeners; i++) batch_io_print_stats(&r->listeners[i].batch, out);
+}
+
+void rdt_receiver_free(struct rdt_receiver *r){
+    for(int i = 0; i < r->num_listeners; i++){
+        batch_io_free(&r->listeners[i].batch);
+        close(r->listeners[i].sockfd);
+    }
+    r->num_listeners = 0;
+    if(r->sessions != NULL) timer_heap_free(&r->timers);
+    if(r->epoll_fd >= 0) close(r->epoll_fd);
+    if(r->wake_fd >= 0) close(r->wake_fd);
+    free(r->sessions);
+    free(r->generations);
+    free(r->peers);
+    r->sessions = NULL;
+    r->generations = NULL;
+    r->peers = NULL;
+    r->epoll_fd = -1;
+    r->wake_fd = -1;
+}
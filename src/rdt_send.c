@@ -0,0 +1,1112 @@
+/*
+@file rdt_send.c
+@brief librdt's sender: one transfer from a source to a receiver
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#define _GNU_SOURCE // for ppoll
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "clock.h"
+#include "pmtu.h"
+#include "rdt.h"
+
+/*
+@brief a slot of the send window: the packet and its retransmission state
+
+the payload is not copied into the slot when the source is in memory,
+data points straight into it. Otherwise the slot is followed by
+payload_size bytes of storage, see copy
+*/
+struct inflight {
+    struct packet_header hdr;   // seq_num in wire form
+    long long seq;
+    const char *data;
+    struct cc_packet_state cc_state;
+    int retransmitted;
+    uint64_t deadline_us;
+    char copy[];
+};
+
+void rdt_send_config_default(struct rdt_send_config *config){
+    memset(config, 0, sizeof(*config));
+    config->cc_algo = CC_CUBIC;
+    config->pacing_mode = PACING_OFF;
+    config->window_capacity = RDT_WINDOW;
+    config->max_payload = MAX_DATA_SIZE;
+    config->batch_size = BATCH_SIZE;
+}
+
+/*
+@brief helper function to send packets, serializes packets to bytes to be sent
+
+@param packettosend: the packet to be sent
+@param sockfd: socket information
+@param receiver_addr: the receiver address to send data to
+@param packet_size: the size of the data to be sent
+
+@return 0 in case of failure, 1 in case of success
+*/
+static int send_packet(const struct packet *packettosend, int sockfd, struct sockaddr_in receiver_addr, size_t packet_size){
+    if (sendto(sockfd, packettosend, packet_size, 0, (const struct sockaddr *) &receiver_addr, sizeof(receiver_addr)) < 0) {
+            perror("send packet failed");
+            return 0;
+        }
+    return 1;
+};
+
+/*
+@brief helper function to send the SYN, once more
+
+acked counts the SYNs and the receiver names the one it answers in
+the SYN-ACK, so the SYN-ACK is an RTT sample even after a resend
+
+@param s: the sender
+*/
+static void send_syn(struct rdt_sender *s){
+    int slots = sizeof(s->syn_sent_us) / sizeof(s->syn_sent_us[0]);
+    s->syn.acked = s->syns_sent;
+    s->syn.crc = crc32c_control(&s->syn, sizeof(s->syn));
+    if(s->syns_sent < slots) s->syn_sent_us[s->syns_sent] = monotonic_us();
+    s->syns_sent++;
+    if(send_packet(&s->syn, s->sockfd, s->peer, sizeof(s->syn)) == 0){
+        perror("Failure to send SYN");
+    }
+}
+
+/*
+@brief helper function to queue a window packet for the next batched send
+
+the header and the payload are referenced in place and gathered by the
+kernel, nothing is copied. The slot stays put until it is acked, which
+can't happen before it is flushed. Only the header and data_len bytes
+go on the wire
+
+@param s: the sender
+@param entry: the packet to send
+
+@return 0 in case of failure, 1 in case of success
+*/
+static int queue_packet(struct rdt_sender *s, struct inflight *entry){
+    struct iovec iov[2];
+    iov[0].iov_base = &entry->hdr;
+    iov[0].iov_len = sizeof(entry->hdr);
+    iov[1].iov_base = (void *)entry->data;
+    iov[1].iov_len = entry->hdr.data_len;
+    return batch_io_queue_iov(&s->batch, iov, 2, &s->peer);
+}
+
+/*
+@brief helper function to (re)arm a packet's retransmission timer
+
+@param s: the sender
+@param entry: the packet that was just sent
+@param now: the time it was sent
+*/
+static void arm_timer(struct rdt_sender *s, struct inflight *entry, uint64_t now){
+    entry->deadline_us = now + rtt_rto(&s->rtt);
+    if(timer_heap_push(&s->timers, entry->deadline_us, entry->seq) == 0){
+        perror("failed to arm retransmission timer");
+    }
+}
+
+/*
+@brief helper function to tell whether a popped timer is still armed
+
+@param s: the sender
+@param timer: the timer entry
+
+@return the packet the timer belongs to, or NULL if it was acked or re-armed
+*/
+static struct inflight* timer_owner(struct rdt_sender *s, struct timer_entry timer){
+    struct inflight *entry = send_window_get(&s->window, timer.key);
+    if(entry == NULL || send_window_is_acked(&s->window, timer.key) || entry->deadline_us != timer.deadline_us) return NULL;
+    return entry;
+}
+
+/*
+@brief helper function to handle timeouts
+
+resends only the packets whose own timer expired. The first expiry
+collapses the congestion window and backs off the RTO, expiries within
+the following RTO are part of the same event and are just resent.
+While data that went out with the SYN has no answer, only the SYN is
+resent and the data waits for the SYN-ACK to tell whether it arrived
+
+@param s: the sender
+
+@return 0 if the receiver stopped responding, 1 otherwise
+*/
+static int handle_timeout(struct rdt_sender *s){
+    uint64_t now = monotonic_us();
+    struct timer_entry timer;
+    while(timer_heap_peek(&s->timers, &timer) && timer.deadline_us <= now){
+        timer_heap_pop(&s->timers, NULL);
+        struct inflight *entry = timer_owner(s, timer);
+        if(entry == NULL) continue;
+
+        // timers firing within one RTO of each other belong to the same event
+        if(now >= s->next_backoff_us){
+            if(rtt_backoff(&s->rtt) > RTO_MAX_RETRIES) return 0;
+            s->stats.timeouts++;
+            cc_on_timeout(&s->cc);
+            s->next_backoff_us = now + rtt_rto(&s->rtt);
+            if(s->conn_id == 0) send_syn(s);
+        }
+        if(s->conn_id == 0){
+            arm_timer(s, entry, now);
+            continue;
+        }
+        if(queue_packet(s, entry) == 0){
+            perror(" error resending packet");
+        }
+        s->stats.retransmits++;
+        pacer_on_send(&s->pacer, sizeof(entry->hdr) + entry->hdr.data_len);
+        entry->retransmitted = 1;
+        cc_on_send(&s->cc, &entry->cc_state, now);
+        arm_timer(s, entry, now);
+    }
+    return 1;
+}
+
+/*
+@brief helper function to resend the data that went out with a SYN the receiver didn't get
+
+The SYN-ACK names the SYN it answers. When that isn't the first one,
+the first was lost and the data right behind it was dropped for lack
+of a session, so it goes out again now instead of on its timers.
+
+@param s: the sender
+*/
+static void resend_early_data(struct rdt_sender *s){
+    uint64_t now = monotonic_us();
+    for(long long seq = s->window.base; seq < s->pack_num; seq++){
+        struct inflight *entry = send_window_get(&s->window, seq);
+        if(entry == NULL || send_window_is_acked(&s->window, seq)) continue;
+        if(queue_packet(s, entry) == 0){
+            perror(" error resending packet");
+        }
+        s->stats.retransmits++;
+        pacer_on_send(&s->pacer, sizeof(entry->hdr) + entry->hdr.data_len);
+        entry->retransmitted = 1;
+        cc_on_send(&s->cc, &entry->cc_state, now);
+        arm_timer(s, entry, now);
+    }
+}
+
+/*
+@brief helper function to wait for an ack until the next retransmission deadline
+
+@param s: the sender
+@param max_wait_ns: the longest to wait, e.g. until the pacer releases a packet, 0 for no limit
+
+@return 1 if the socket is readable, 0 if a timer came due, -1 on error
+*/
+static int wait_for_ack(struct rdt_sender *s, uint64_t max_wait_ns){
+    // discard timers of acked packets so they don't cut the wait short
+    struct timer_entry timer;
+    while(timer_heap_peek(&s->timers, &timer) && timer_owner(s, timer) == NULL){
+        timer_heap_pop(&s->timers, NULL);
+    }
+
+    int bounded = max_wait_ns > 0;
+    uint64_t wait_ns = max_wait_ns;
+    if(timer_heap_peek(&s->timers, &timer)){
+        uint64_t now = monotonic_us();
+        uint64_t timer_ns = timer.deadline_us > now ? (timer.deadline_us - now) * 1000ULL : 0;
+        if(!bounded || timer_ns < wait_ns) wait_ns = timer_ns;
+        bounded = 1;
+    }
+    struct timespec ts;
+    struct timespec *tsp = NULL;
+    if(bounded){
+        ts.tv_sec = wait_ns / 1000000000ULL;
+        ts.tv_nsec = wait_ns % 1000000000ULL;
+        tsp = &ts;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = s->sockfd;
+    pfd.events = POLLIN;
+    int ready = ppoll(&pfd, 1, tsp, NULL);
+    if(ready < 0){
+        if(errno == EINTR) return 0;
+        perror("ppoll failed");
+        return -1;
+    }
+    return ready > 0;
+}
+
+/*
+@brief helper function to probe a closed receive window
+
+with nothing in flight no ack will come to reopen the window, so a
+header-only probe is sent on a backed off timer until one does. Probes
+are not counted as timeouts, a slow disk is not a dead receiver
+
+@param s: the sender
+@param blocked: 1 if new data is held back only by the receive window
+
+@return nanoseconds until the next probe is due, 0 if no probe is pending
+*/
+static uint64_t handle_zero_window(struct rdt_sender *s, int blocked){
+    if(!blocked || send_window_count(&s->window) > 0){
+        s->probe_deadline_us = 0;
+        return 0;
+    }
+    uint64_t now = monotonic_us();
+    if(s->probe_deadline_us == 0){
+        s->probe_interval_us = rtt_rto(&s->rtt);
+        s->probe_deadline_us = now + s->probe_interval_us;
+    } else if(now >= s->probe_deadline_us){
+        struct packet_header probe;
+        probe.seq_num = -3;
+        probe.data_len = 0;
+        probe.conn_id = s->conn_id;
+        probe.crc = crc32c_control(&probe, sizeof(probe));
+        if(batch_io_queue(&s->batch, &probe, sizeof(probe), &s->peer, 1) == 0){
+            perror("failed to send window probe");
+        }
+        s->stats.probes++;
+        s->probe_interval_us = s->probe_interval_us * 2 < RDT_PROBE_MAX_US ? s->probe_interval_us * 2 : RDT_PROBE_MAX_US;
+        s->probe_deadline_us = now + s->probe_interval_us;
+    }
+    return (s->probe_deadline_us - now) * 1000ULL;
+}
+
+/*
+@brief helper function to fast retransmit lost packets
+
+a packet is considered lost once CC_DUP_THRESH packets sent after it
+have been acked, it is resent right away instead of waiting for the
+timeout and the congestion controller is told about the loss. Every
+sequence number is examined once, so this is O(1) amortized per ack
+
+@param s: the sender
+*/
+static void handle_fast_retransmit(struct rdt_sender *s){
+    uint64_t now = monotonic_us();
+    if(s->fast_retransmit_next < s->window.base) s->fast_retransmit_next = s->window.base;
+    for(; s->fast_retransmit_next + CC_DUP_THRESH <= s->highest_acked; s->fast_retransmit_next++){
+        struct inflight *entry = send_window_get(&s->window, s->fast_retransmit_next);
+        if(entry == NULL || send_window_is_acked(&s->window, s->fast_retransmit_next) || entry->retransmitted) continue;
+
+        cc_on_loss(&s->cc, entry->seq, s->pack_num);
+        if(queue_packet(s, entry) == 0){
+            perror(" error fast retransmitting packet");
+        }
+        s->stats.retransmits++;
+        s->stats.fast_retransmits++;
+        pacer_on_send(&s->pacer, sizeof(entry->hdr) + entry->hdr.data_len);
+        entry->retransmitted = 1;
+        cc_on_send(&s->cc, &entry->cc_state, now);
+        arm_timer(s, entry, now);
+    }
+}
+
+/*
+@brief per ack bookkeeping for the packets an ack newly covers
+*/
+struct ack_progress {
+    struct rdt_sender *sender;
+    uint64_t now;
+    int acked;                  // packets this ack newly covers
+    struct inflight *newest;    // latest sent, never resent packet: the RTT sample
+};
+
+/*
+@brief callback for every packet an ack newly covers, feeds the congestion controller
+
+@param seq: the newly acked sequence number
+@param ctx: the ack's struct ack_progress
+*/
+static void on_packet_acked(long long seq, void *ctx){
+    struct ack_progress *progress = ctx;
+    struct rdt_sender *s = progress->sender;
+    struct inflight *entry = send_window_get(&s->window, seq);
+    cc_on_ack(&s->cc, seq, &entry->cc_state, progress->now, entry->retransmitted);
+    // Karn's rule: an ack for a resent packet is ambiguous, don't sample it
+    if(!entry->retransmitted && (progress->newest == NULL || entry->cc_state.sent_us > progress->newest->cc_state.sent_us)){
+        progress->newest = entry;
+    }
+    if(seq > s->highest_acked) s->highest_acked = seq;
+    s->stats.bytes_acked += entry->hdr.data_len;
+    progress->acked++;
+}
+
+/*
+@brief helper function to handle receiving acks
+
+marks everything below the cumulative ack and inside the sack
+blocks as acked, feeds the congestion controller, takes one RTT
+sample per ack, takes the receive window from the newest ack, fast
+retransmits holes and slides the send window if needed
+
+@param s: the sender
+@param ack: the incoming ack
+@param len: the number of bytes received for it
+*/
+static void handle_ack_recv(struct rdt_sender *s, const struct ack_packet *ack, ssize_t len){
+    // data sent with the SYN can be acked before the SYN-ACK arrives, the ack has the ID too
+    if(s->conn_id == 0 && ack->seq_num >= 0) s->conn_id = ack->conn_id;
+    if(ack->conn_id != s->conn_id) return;
+    // -1 is a resent SYN-ACK: our handshake ack was lost and the receiver
+    // holds off on data until it knows the payload size, ack again
+    if(ack->seq_num == -1){
+        if(batch_io_queue(&s->batch, &s->handshake_ack, sizeof(s->handshake_ack), &s->peer, 1) == 0){
+            perror("failed to resend handshake ack");
+        }
+        return;
+    }
+    if(ack->seq_num < 0) return;
+    long long cumulative = seq_unwrap(ack->seq_num, s->window.base);
+
+    // an ack overtaken by a later one carries a stale window
+    if(cumulative >= s->rwnd_ack){
+        s->rwnd_ack = cumulative;
+        s->rwnd_edge = cumulative + ack->window;
+    }
+
+    struct ack_progress progress;
+    progress.sender = s;
+    progress.now = monotonic_us();
+    progress.newest = NULL;
+    progress.acked = 0;
+
+    send_window_ack_range(&s->window, s->window.base, cumulative, on_packet_acked, &progress);
+    int num_sacks = ack->num_sacks;
+    long long max_sacks = (len - (ssize_t)offsetof(struct ack_packet, sacks)) / (ssize_t)sizeof(struct sack_block);
+    if(num_sacks > max_sacks) num_sacks = max_sacks;
+    for(int i = 0; i < num_sacks; i++){
+        long long start = seq_unwrap(ack->sacks[i].start, s->window.base);
+        long long end = seq_unwrap(ack->sacks[i].end, s->window.base);
+        send_window_ack_range(&s->window, start, end, on_packet_acked, &progress);
+    }
+    if(progress.newest != NULL){
+        uint64_t sample = progress.now - progress.newest->cc_state.sent_us;
+        rtt_sample(&s->rtt, sample);
+        histogram_record(&s->stats.rtt, sample);
+    }
+    s->stats.acks++;
+    if(progress.acked == 0) s->stats.dup_acks++;
+    int cwnd = cc_window(&s->cc);
+    if(cwnd > s->stats.cwnd_max) s->stats.cwnd_max = cwnd;
+
+    handle_fast_retransmit(s);
+    send_window_advance(&s->window);
+}
+
+/*
+@brief helper function to take the connection ID and an RTT sample from the SYN-ACK
+
+@param s: the sender
+@param SYN_ACK: the SYN-ACK
+*/
+static void take_syn_ack(struct rdt_sender *s, const struct packet *SYN_ACK){
+    int slots = sizeof(s->syn_sent_us) / sizeof(s->syn_sent_us[0]);
+    // -1 is a resend on the receiver's own timer, it times nothing
+    if(SYN_ACK->acked >= 0 && SYN_ACK->acked < s->syns_sent && SYN_ACK->acked < slots){
+        rtt_sample(&s->rtt, monotonic_us() - s->syn_sent_us[SYN_ACK->acked]);
+    }
+    s->conn_id = SYN_ACK->conn_id;
+}
+
+/*
+@brief helper function to wait for the SYN-ACK, taking in the echoes of the probes sent with the SYN
+
+@param s: the sender
+@param search: the path MTU search
+@param SYN_ACK: where to store the SYN-ACK, NULL to wait only for the echoes
+@param deadline_us: when to stop waiting
+
+@return 1 if the SYN-ACK arrived, 0 otherwise
+*/
+static int await_handshake(struct rdt_sender *s, struct pmtu_search *search, struct packet *SYN_ACK, uint64_t deadline_us){
+    uint64_t now;
+    while((now = monotonic_us()) < deadline_us && (SYN_ACK != NULL || !pmtu_search_done(search))){
+        struct pollfd pfd;
+        pfd.fd = s->sockfd;
+        pfd.events = POLLIN;
+        struct timespec ts;
+        ts.tv_sec = (deadline_us - now) / 1000000;
+        ts.tv_nsec = (deadline_us - now) % 1000000 * 1000;
+        if(ppoll(&pfd, 1, &ts, NULL) <= 0) continue;
+
+        struct packet reply;
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t len = recvfrom(s->sockfd, &reply, sizeof(reply), MSG_DONTWAIT, (struct sockaddr *)&from, &from_len);
+        if(len <= 0 || pmtu_search_echo(search, &reply, len)) continue;
+        // a damaged SYN-ACK counts as lost
+        if(SYN_ACK != NULL && len == (ssize_t)sizeof(reply) && reply.seq_num == -1 &&
+           crc32c_control(&reply, sizeof(reply)) == reply.crc){
+            *SYN_ACK = reply;
+            s->peer = from;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+@brief helper function to initiate connection with the receiver
+
+This function initiates the connection with the receiver, it
+sends the expected bytes, the largest payload the local route
+carries, where in the file the data goes and the file's length and
+name to the receiver and takes the connection ID, the receiver's
+initial receive window and the largest payload both ends accept from
+its answer. The path MTU probes go right behind the SYN, so their
+echoes come back with the SYN-ACK and everything is settled in one
+round trip. It then acks with the payload size. After that every ack
+carries the current window.
+
+The SYN is resent on a timeout that starts at RTO_HANDSHAKE_US and
+backs off, so a lost SYN or SYN-ACK costs milliseconds.
+
+A transfer that fits in RDT_EARLY_PACKETS DATA_SIZE packets doesn't
+wait for the SYN-ACK at all: its SYN offers DATA_SIZE, which leaves the
+receiver nothing to agree on, and the data goes out right behind it
+with no connection ID. The SYN-ACK, or the first ack, brings the ID
+later, and until one of them does a timeout resends the SYN too.
+
+@param s: the sender
+@param SYN_size: size of the SYN packet
+@param early: 1 to send the data right behind the SYN
+
+@return 0 in case of failure, 1 in case of success
+*/
+static int initiate_connection(struct rdt_sender *s, size_t SYN_size, int early){
+    struct packet *SYN = &s->syn;
+    memset(SYN, 0, sizeof(*SYN));
+    SYN->seq_num = -1;
+    SYN->data_len = SYN_size;
+    SYN->conn_id = 0;
+    int ceiling = early ? DATA_SIZE : pmtu_route_payload(&s->peer);
+    if(ceiling > s->config.max_payload) ceiling = s->config.max_payload;
+    int fec_k = s->config.fec_k >= 0 && s->config.fec_k <= FEC_MAX_K ? s->config.fec_k : 0;
+    snprintf(SYN->data, sizeof(SYN->data), "%llu %d %llu %llu %d %d %lld %.255s", s->bytes_total, ceiling, s->config.range_offset,
+             s->config.file_length, fec_k, s->config.compress != 0, s->mtime, s->config.name != NULL ? s->config.name : "");
+    // advance global sequence number
+    s->pack_num++;
+    s->syns_sent = 0;
+    rtt_init(&s->rtt, RTO_HANDSHAKE_US);
+
+    // the handshake ack tells the receiver the payload size, it is resent for a resent SYN-ACK
+    struct ack_packet *ack = &s->handshake_ack;
+    ack->seq_num = -1;
+    ack->window = DATA_SIZE;
+    ack->conn_id = 0;
+    ack->num_sacks = 0;
+    ack->crc = crc32c_control(ack, sizeof(*ack));
+    if(early){
+        // the receiver takes the parity it is offered at DATA_SIZE, nothing else is left to hear
+        s->fec_k = fec_k;
+        s->payload_size = DATA_SIZE;
+        s->rwnd_ack = s->pack_num;
+        s->rwnd_edge = s->pack_num + RDT_EARLY_PACKETS;
+        send_syn(s);
+        return 1;
+    }
+
+    // send the SYN with the probes behind it, resending it with backoff until the SYN-ACK arrives
+    struct pmtu_search search;
+    int probing = pmtu_search_init(&search, s->sockfd, ceiling);
+    struct packet SYN_ACK;
+    while(1){
+        send_syn(s);
+        if(probing && s->syns_sent == 1) pmtu_search_send(&search, s->sockfd, &s->peer, 0);
+        if(await_handshake(s, &search, &SYN_ACK, monotonic_us() + rtt_rto(&s->rtt))) break;
+        if(rtt_backoff(&s->rtt) > RTO_MAX_RETRIES){
+            fprintf(stderr, "receiver did not answer the SYN\n");
+            pmtu_search_free(&search, s->sockfd);
+            return 0;
+        }
+    }
+    take_syn_ack(s, &SYN_ACK);
+
+    // deserialize the initial receive window, data starts at pack_num
+    int rwnd = 0;
+    int agreed = DATA_SIZE;
+    int accepted = 0;
+    int compress = 0;
+    unsigned long long resumed = 0;
+    SYN_ACK.data[DATA_SIZE - 1] = '\0';
+    sscanf(SYN_ACK.data, "%d %d %d %d %llu", &rwnd, &agreed, &accepted, &compress, &resumed);
+    // a receiver that doesn't know parity or compression leaves those numbers out
+    s->fec_k = accepted == fec_k ? fec_k : 0;
+    s->compress = s->config.compress && compress == 1;
+    // the receiver only skips what it has of a file it can tell is ours
+    s->resumed = s->mtime != 0 && resumed <= s->bytes_total ? resumed : 0;
+    s->rwnd_ack = s->pack_num;
+    s->rwnd_edge = s->pack_num + rwnd;
+    if(agreed > ceiling) agreed = ceiling;
+
+    // the echoes left the receiver right behind its SYN-ACK, give the last of them a moment
+    if(probing) await_handshake(s, &search, NULL, monotonic_us() + s->rtt.srtt_us / 4 + RTO_GRANULARITY_US);
+    int best = search.best;
+    pmtu_search_free(&search, s->sockfd);
+    // only when every probe sent with the SYN was lost does the search take a round trip of its own
+    s->payload_size = best > DATA_SIZE && best <= agreed ? best : pmtu_discover(s->sockfd, &s->peer, agreed, s->rtt.srtt_us, s->conn_id);
+    // a parity packet carries a fec_header on top of a full payload, and has to fit the path too
+    if(s->fec_k > 0 && s->payload_size - (int)sizeof(struct fec_header) >= DATA_SIZE){
+        s->payload_size -= sizeof(struct fec_header);
+    }
+
+    ack->window = s->payload_size;
+    ack->conn_id = s->conn_id;
+    ack->crc = crc32c_control(ack, sizeof(*ack));
+    if (sendto(s->sockfd, ack, sizeof(*ack), 0, (const struct sockaddr *) &s->peer, sizeof(s->peer)) < 0) {
+        perror("failed to send ack");
+    }
+    return 1;
+}
+
+/*
+@brief helper function to send the parity of the block so far
+
+The parity is referenced, not copied, so the batch goes out right away
+before the next block overwrites it.
+
+@param s: the sender
+
+@return 0 in case of failure, 1 in case of success
+*/
+static int send_parity(struct rdt_sender *s){
+    size_t len = fec_encoder_finish(&s->fec, s->conn_id);
+    if(len == 0) return 1;
+    struct packet_header hdr;
+    memcpy(&hdr, s->fec.datagram, sizeof(hdr));
+    hdr.crc = crc32c_packet(&hdr, crc32c(0, s->fec.datagram + sizeof(hdr), len - sizeof(hdr)));
+    memcpy(s->fec.datagram, &hdr, sizeof(hdr));
+    if(batch_io_queue(&s->batch, s->fec.datagram, len, &s->peer, 0) == 0) return 0;
+    pacer_on_send(&s->pacer, len);
+    s->stats.parity_sent++;
+    return batch_io_flush(&s->batch);
+}
+
+/*
+@brief helper function to compare the CRC32C of everything sent with the receiver's
+
+The digest is built as the data is sent, from the packets' own CRCs,
+so it costs no pass over the data of its own. It goes out on a backed
+off timer until the receiver answers with its own.
+
+@param s: the sender, with every packet acked
+
+@return 1 if they match, 0 if they don't, -1 if the receiver didn't answer
+*/
+static int confirm_digest(struct rdt_sender *s){
+    struct packet digest;
+    digest.seq_num = -6;
+    digest.data_len = sizeof(s->digest);
+    digest.conn_id = s->conn_id;
+    memcpy(digest.data, &s->digest, sizeof(s->digest));
+    size_t size = sizeof(struct packet_header) + sizeof(s->digest);
+    digest.crc = crc32c_control(&digest, size);
+    uint64_t wait_us = rtt_rto(&s->rtt);
+    for(int tries = 0; tries < RDT_DIGEST_TRIES; tries++, wait_us *= 2){
+        if(sendto(s->sockfd, &digest, size, 0, (const struct sockaddr *)&s->peer, sizeof(s->peer)) < 0){
+            perror("failed to send the digest");
+        }
+        uint64_t deadline = monotonic_us() + wait_us;
+        uint64_t now;
+        // late acks may still be on their way, skip them
+        while((now = monotonic_us()) < deadline){
+            struct pollfd pfd;
+            pfd.fd = s->sockfd;
+            pfd.events = POLLIN;
+            struct timespec ts;
+            ts.tv_sec = (deadline - now) / 1000000;
+            ts.tv_nsec = (deadline - now) % 1000000 * 1000;
+            if(ppoll(&pfd, 1, &ts, NULL) <= 0) continue;
+            struct packet reply;
+            ssize_t len = recv(s->sockfd, &reply, size, MSG_DONTWAIT);
+            if(len == (ssize_t)size && reply.seq_num == -6 && reply.conn_id == s->conn_id &&
+               crc32c_control(&reply, size) == reply.crc){
+                return memcmp(reply.data, &s->digest, sizeof(s->digest)) == 0;
+            }
+        }
+    }
+    return -1;
+}
+
+/*
+@brief helper function to find the source's data in memory, so packets can point straight into it
+
+a file descriptor is mapped if it is a regular file, pipes and the
+like are left to fill_staging()
+
+@param s: the sender
+
+@return 1 if the data is in memory, 0 if it has to be read
+*/
+static int map_source(struct rdt_sender *s){
+    if(s->source.kind == RDT_MEMORY){
+        s->map = s->source.data;
+        s->map_len = s->source.len;
+        return 1;
+    }
+    struct stat st;
+    if(s->source.kind != RDT_FD || fstat(s->source.fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0) return 0;
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, s->source.fd, 0);
+    if(map == MAP_FAILED) return 0;
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    s->map = map;
+    s->map_len = st.st_size;
+    s->owns_map = 1;
+    return 1;
+}
+
+/*
+@brief helper function to fill a buffer from an unmapped source, retrying short reads
+
+@param s: the sender
+@param buf: the buffer
+@param have: the bytes already in it
+@param want: the bytes it should hold
+
+@return the bytes it holds, less than want only at the end of the data
+*/
+static size_t read_source(struct rdt_sender *s, char *buf, size_t have, size_t want){
+    while(have < want){
+        size_t got;
+        if(s->source.kind == RDT_CALLBACK){
+            got = s->source.read(s->source.arg, buf + have, want - have);
+        } else {
+            ssize_t n = read(s->source.fd, buf + have, want - have);
+            if(n < 0 && errno == EINTR) continue;
+            if(n < 0) perror("failed to read the source");
+            got = n > 0 ? n : 0;
+        }
+        if(got == 0) break;
+        have += got;
+    }
+    return have;
+}
+
+/*
+@brief helper function to read the next payload of an unmapped source into staging
+
+every packet but the last has to be full, the receiver stores packet
+n at n payloads into the range, so short reads are retried until the
+payload is full or the source ends
+
+@param s: the sender
+@param want: the payload's size
+
+@return the bytes staged, 0 at the end of the data
+*/
+static size_t fill_staging(struct rdt_sender *s, size_t want){
+    s->staged = read_source(s, s->staging, s->staged, want);
+    return s->staged;
+}
+
+/*
+@brief helper function to stage the next payload of the compressed stream
+
+A new block is read and framed once the last one is in packets. Its
+raw bytes count as sent then, the packets carry the framed stream.
+
+@param s: the sender
+@param bytes: the raw bytes to send in all
+
+@return the bytes staged, 0 at the end of the data
+*/
+static size_t fill_compressed(struct rdt_sender *s, unsigned long long bytes){
+    struct compressor *c = &s->compressor;
+    if(c->sent == c->len){
+        size_t block = bytes - s->bytes_sent < COMPRESS_BLOCK ? bytes - s->bytes_sent : COMPRESS_BLOCK;
+        unsigned long long pos = s->config.range_offset + s->bytes_sent;
+        const char *data = c->raw;
+        if(c->raw == NULL){
+            // the source is in memory, compress it in place
+            if(pos >= s->map_len) return 0;
+            if(s->map_len - pos < block) block = s->map_len - pos;
+            data = s->map + pos;
+        } else {
+            block = read_source(s, c->raw, 0, block);
+        }
+        if(block == 0) return 0;
+        s->digest = crc32c(s->digest, data, block);
+        compressor_pack(c, data, block);
+        s->bytes_sent += block;
+    }
+    size_t take = c->len - c->sent < (size_t)s->payload_size ? c->len - c->sent : (size_t)s->payload_size;
+    memcpy(s->staging, c->frame + c->sent, take);
+    c->sent += take;
+    s->staged = take;
+    return take;
+}
+
+/*
+@brief helper function to write the transfer's counters as one telemetry line
+
+@param s: the sender
+@param now: the current monotonic time in microseconds
+@param summary: 1 for the line written when the transfer is over, with the RTT percentiles
+*/
+static void emit_stats(struct rdt_sender *s, uint64_t now, int summary){
+    const struct rdt_send_stats *st = &s->stats;
+    uint64_t elapsed = now - st->started_us;
+    double goodput = elapsed > 0 ? st->bytes_acked * 8.0 / elapsed : 0.0;
+    if(!summary){
+        telemetry_emit(s->config.telemetry, "\"type\":\"sample\",\"side\":\"send\",\"t_us\":%llu,\"conn_id\":%d,"
+                       "\"bytes_sent\":%llu,\"bytes_acked\":%llu,\"inflight\":%d,\"cwnd\":%d,\"rwnd\":%lld,"
+                       "\"srtt_us\":%llu,\"rto_us\":%llu,\"packets_sent\":%llu,\"retransmits\":%llu,\"goodput_mbps\":%.2f",
+                       (unsigned long long)elapsed, s->conn_id, s->bytes_sent, st->bytes_acked, send_window_count(&s->window),
+                       cc_window(&s->cc), s->rwnd_edge - s->pack_num, (unsigned long long)s->rtt.srtt_us,
+                       (unsigned long long)rtt_rto(&s->rtt), st->packets_sent, st->retransmits, goodput);
+        return;
+    }
+    telemetry_emit(s->config.telemetry, "\"type\":\"summary\",\"side\":\"send\",\"t_us\":%llu,\"conn_id\":%d,"
+                   "\"complete\":%s,\"bytes_sent\":%llu,\"bytes_acked\":%llu,\"packets_sent\":%llu,\"retransmits\":%llu,"
+                   "\"fast_retransmits\":%llu,\"timeouts\":%llu,\"acks\":%llu,\"dup_acks\":%llu,\"probes\":%llu,"
+                   "\"parity_sent\":%llu,\"cwnd_max\":%d,\"resumed\":%llu,\"digest_match\":%d,"
+                   "\"rtt_p50_us\":%llu,\"rtt_p90_us\":%llu,\"rtt_p99_us\":%llu,\"rtt_max_us\":%llu,\"goodput_mbps\":%.2f",
+                   (unsigned long long)elapsed, s->conn_id, s->complete ? "true" : "false", s->bytes_sent, st->bytes_acked,
+                   st->packets_sent, st->retransmits, st->fast_retransmits, st->timeouts, st->acks, st->dup_acks, st->probes,
+                   st->parity_sent, st->cwnd_max, s->resumed, s->digest_match, (unsigned long long)histogram_percentile(&st->rtt, 50),
+                   (unsigned long long)histogram_percentile(&st->rtt, 90), (unsigned long long)histogram_percentile(&st->rtt, 99),
+                   (unsigned long long)st->rtt.max, goodput);
+}
+
+/*
+@brief helper function to release what one transfer set up, the source stays the caller's
+
+@param s: the sender
+*/
+static void release(struct rdt_sender *s){
+    struct batch_io spent = s->batch;
+    batch_io_free(&s->batch);
+    // keep the counters for rdt_send_print_stats()
+    s->batch.stats = spent.stats;
+    s->batch.size = spent.size;
+    s->batch.gso = spent.gso;
+    send_window_free(&s->window);
+    timer_heap_free(&s->timers);
+    if(s->fec_k > 0) fec_encoder_free(&s->fec);
+    compressor_free(&s->compressor);
+    if(s->owns_map) munmap((void *)s->map, s->map_len);
+    free(s->staging);
+    s->map = NULL;
+    s->owns_map = 0;
+    s->staging = NULL;
+    close(s->sockfd);
+}
+
+int rdt_send(struct rdt_sender *s, const char *host, unsigned short int port, struct rdt_source source, unsigned long long bytes){
+    s->source = source;
+    s->map = NULL;
+    s->map_len = 0;
+    s->owns_map = 0;
+    s->staging = NULL;
+    s->staged = 0;
+    s->rwnd_edge = 0;
+    s->rwnd_ack = -1;
+    s->probe_deadline_us = 0;
+    s->probe_interval_us = 0;
+    s->payload_size = DATA_SIZE;
+    s->conn_id = 0;
+    s->fec_k = 0;
+    s->compress = 0;
+    memset(&s->compressor, 0, sizeof(s->compressor));
+    s->pack_num = -1;
+    s->highest_acked = -1;
+    s->fast_retransmit_next = 0;
+    s->next_backoff_us = 0;
+    s->bytes_sent = 0;
+    s->mtime = 0;
+    s->resumed = 0;
+    s->digest = 0;
+    s->digest_match = -1;
+    s->complete = 0;
+    memset(&s->stats, 0, sizeof(s->stats));
+    histogram_init(&s->stats.rtt);
+    s->stats.started_us = monotonic_us();
+    s->next_sample_us = s->stats.started_us;
+
+    // Create socket
+    if ((s->sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+        perror("socket creation failed");
+        return 0;
+    }
+    memset(&s->peer, 0, sizeof(s->peer));
+
+    // Filling server information
+    s->peer.sin_family = AF_INET;
+    s->peer.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &s->peer.sin_addr) <= 0) {
+        perror("Invalid address/ Address not supported");
+        close(s->sockfd);
+        return 0;
+    }
+
+    int mapped = map_source(s);
+    // the file's length and modification time tell the receiver whether an earlier try left it part of it
+    struct stat st;
+    if(mapped && source.kind == RDT_FD && fstat(source.fd, &st) == 0){
+        s->mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    }
+    if(!mapped && source.kind == RDT_FD && s->config.range_offset > 0 &&
+       lseek(source.fd, s->config.range_offset, SEEK_SET) < 0){
+        perror("Failed to seek to the stream's range");
+        close(s->sockfd);
+        return 0;
+    }
+
+    // announce what the source really holds, so the receiver knows when it has it all
+    unsigned long long offset = s->config.range_offset;
+    if(mapped){
+        unsigned long long left = s->map_len > offset ? s->map_len - offset : 0;
+        if(bytes > left) bytes = left;
+    }
+    s->bytes_total = bytes;
+    unsigned long long file_length = s->config.file_length;
+    if(mapped && s->config.file_length == 0){
+        s->config.file_length = offset + bytes < s->map_len ? offset + bytes : s->map_len;
+    }
+
+    // a transfer that fits in the first flight goes out with its SYN, there is nothing worth resuming in it
+    int early = mapped && bytes > 0 && bytes <= (unsigned long long)RDT_EARLY_PACKETS * DATA_SIZE && !s->config.compress;
+    if(early) s->mtime = 0;
+
+    // establish connection with receiver
+    size_t SYN_size = 516;
+    int connected = initiate_connection(s, SYN_size, early);
+    s->config.file_length = file_length;
+    if(connected == 0){
+        if(s->owns_map) munmap((void *)s->map, s->map_len);
+        close(s->sockfd);
+        return 0;
+    }
+
+    // the receiver has the range's first resumed bytes already, go on from there
+    s->bytes_sent = s->resumed;
+
+    // pipes and the like can't be mapped, their packets keep a copy of the payload, as do compressed ones
+    int direct = mapped && !s->compress;
+    size_t slot_size = sizeof(struct inflight);
+    if(!direct) slot_size += (s->payload_size + 7) / 8 * 8;
+    int capacity = s->config.window_capacity;
+    int window_ok = send_window_init(&s->window, capacity, slot_size, s->pack_num);
+    int timers_ok = timer_heap_init(&s->timers, capacity);
+    int batch_ok = batch_io_init(&s->batch, s->sockfd, s->config.batch_size, BUFFER_SIZE);
+    if(!direct) s->staging = malloc(s->payload_size);
+    int fec_ok = s->fec_k == 0 || fec_encoder_init(&s->fec, s->fec_k, s->payload_size);
+    int compress_ok = !s->compress || compressor_init(&s->compressor, !mapped);
+    if(window_ok == 0 || timers_ok == 0 || batch_ok == 0 || fec_ok == 0 || compress_ok == 0 || (!direct && s->staging == NULL)){
+        if(!direct && s->staging == NULL) perror("staging malloc failed");
+        if(fec_ok == 0) perror("parity malloc failed");
+        if(compress_ok == 0) perror("compression malloc failed");
+        if(window_ok) send_window_free(&s->window);
+        if(timers_ok) timer_heap_free(&s->timers);
+        if(batch_ok) batch_io_free(&s->batch);
+        if(s->fec_k > 0 && fec_ok) fec_encoder_free(&s->fec);
+        if(compress_ok) compressor_free(&s->compressor);
+        if(s->owns_map) munmap((void *)s->map, s->map_len);
+        free(s->staging);
+        s->staging = NULL;
+        s->owns_map = 0;
+        close(s->sockfd);
+        return 0;
+    }
+    cc_init(&s->cc, s->config.cc_algo, capacity);
+    crc32c_shift_init(&s->shift, s->payload_size);
+    if(s->config.use_gso && batch_io_enable_gso(&s->batch) == 0){
+        fprintf(stderr, "UDP GSO is not supported here, sending one datagram per message\n");
+    }
+    pacer_init(&s->pacer, s->config.pacing_mode, s->config.pacing_rate, sizeof(struct packet_header) + s->payload_size, s->sockfd);
+
+    // Read and send the data in chunks, then wait for the window to drain
+    int input_ended = 0;
+    while (((s->bytes_sent < bytes || s->compressor.sent < s->compressor.len) && !input_ended) ||
+           send_window_count(&s->window) > 0) {
+        if(s->config.telemetry != NULL){
+            uint64_t now = monotonic_us();
+            if(now >= s->next_sample_us){
+                emit_stats(s, now, 0);
+                s->next_sample_us = now + s->config.telemetry->interval_us;
+            }
+        }
+        // in flight is capped at min(cwnd, rwnd), a packet they allow may still have to wait for the pacer
+        uint64_t pace_ns = 0;
+        int has_data = (s->bytes_sent < bytes || s->compressor.sent < s->compressor.len) && !input_ended;
+        int can_send = has_data && send_window_count(&s->window) < cc_window(&s->cc) && s->pack_num < s->rwnd_edge;
+        if(can_send){
+            pacer_update(&s->pacer, &s->cc, s->rtt.srtt_us);
+            pace_ns = pacer_delay(&s->pacer);
+        }
+        // a block cut short by the end of the data still gets its parity
+        if(s->fec_k > 0 && !has_data && send_parity(s) == 0) break;
+        // if buffer is full or the source ended/all data sent, wait for ack/timeout
+        if(!can_send || pace_ns > 0){
+            // resend whatever expired, push out the batch, then sleep until an ack or the next deadline
+            if(handle_timeout(s) == 0){
+                fprintf(stderr, "receiver stopped responding, giving up\n");
+                break;
+            }
+            uint64_t probe_ns = handle_zero_window(s, has_data && s->pack_num >= s->rwnd_edge);
+            if(batch_io_flush(&s->batch) == 0) break;
+            int ready = wait_for_ack(s, pace_ns > 0 ? pace_ns : probe_ns);
+            if(ready < 0) break;
+            if(ready == 0) continue;
+
+            // drain every ack that is waiting in one call
+            int count = batch_io_recv(&s->batch, MSG_DONTWAIT);
+            if(count < 0) break;
+            for(int i = 0; i < count; i++){
+                size_t len;
+                struct ack_packet received;
+                char *data = batch_io_datagram(&s->batch, i, &len, NULL);
+                if(len < offsetof(struct ack_packet, sacks)) continue;
+                memcpy(&received, data, len < sizeof(received) ? len : sizeof(received));
+                // a damaged ack could claim packets that never arrived
+                if(crc32c_control(data, len) != received.crc) continue;
+                if(s->conn_id == 0 && received.seq_num == -1 && len == sizeof(struct packet)){
+                    // the SYN-ACK of a transfer that went out with its SYN
+                    struct packet SYN_ACK;
+                    memcpy(&SYN_ACK, data, sizeof(SYN_ACK));
+                    take_syn_ack(s, &SYN_ACK);
+                    if(SYN_ACK.acked > 0) resend_early_data(s);
+                    continue;
+                }
+                handle_ack_recv(s, &received, len);
+            }
+            // fast retransmits go out before new data reuses any slot
+            if(batch_io_flush(&s->batch) == 0) break;
+        }
+        // otherwise go as normal
+        else {
+            size_t toRead = s->payload_size;
+            if (bytes - s->bytes_sent < toRead) {
+                toRead = bytes - s->bytes_sent;
+            }
+            // find the end of the input before taking a slot for it
+            unsigned long long pos = offset + s->bytes_sent;
+            if(s->compress){
+                toRead = fill_compressed(s, bytes);
+                if(toRead == 0){
+                    input_ended = 1;
+                    continue;
+                }
+            } else if(mapped){
+                if(pos >= s->map_len){
+                    input_ended = 1;
+                    continue;
+                }
+                if(s->map_len - pos < toRead) toRead = s->map_len - pos;
+            } else {
+                toRead = fill_staging(s, toRead);
+                if(toRead == 0){
+                    input_ended = 1;
+                    continue;
+                }
+            }
+            // the window has room: cwnd never exceeds its capacity
+            struct inflight* send_pkt = send_window_push(&s->window, NULL);
+            if(direct){
+                send_pkt->data = s->map + pos;
+            } else {
+                memcpy(send_pkt->copy, s->staging, toRead);
+                s->staged = 0;
+                send_pkt->data = send_pkt->copy;
+            }
+
+            send_pkt->seq = s->pack_num;
+            send_pkt->hdr.seq_num = seq_wire(s->pack_num);
+            send_pkt->hdr.data_len = toRead;
+            send_pkt->hdr.conn_id = s->conn_id;
+            uint32_t payload_crc = crc32c(0, send_pkt->data, toRead);
+            send_pkt->hdr.crc = crc32c_packet(&send_pkt->hdr, payload_crc);
+            if(!s->compress){
+                s->digest = toRead == (size_t)s->payload_size ? crc32c_shift_combine(&s->shift, s->digest, payload_crc)
+                                                              : crc32c_combine(s->digest, payload_crc, toRead);
+            }
+            send_pkt->retransmitted = 0;
+            s->pack_num++;
+            if (queue_packet(s, send_pkt) == 0) {
+                break;
+            }
+            pacer_on_send(&s->pacer, sizeof(send_pkt->hdr) + toRead);
+            uint64_t now = monotonic_us();
+            cc_on_send(&s->cc, &send_pkt->cc_state, now);
+            arm_timer(s, send_pkt, now);
+
+            // advance read pointer, a compressed block counted when it was read
+            if(!s->compress) s->bytes_sent += toRead;
+            s->stats.packets_sent++;
+            if(s->fec_k > 0 && fec_encoder_add(&s->fec, send_pkt->seq, send_pkt->data, toRead) && send_parity(s) == 0){
+                break;
+            }
+        }
+
+    }
+    s->complete = send_window_count(&s->window) == 0 && (s->bytes_sent >= bytes || input_ended) &&
+                  s->compressor.sent == s->compressor.len;
+    // specify reason to transmission end
+    if (s->bytes_sent < bytes) {
+        struct packet FIN;
+        FIN.seq_num = -2;
+        FIN.data_len = 0;
+        FIN.conn_id = s->conn_id;
+        FIN.crc = crc32c_control(&FIN, sizeof(struct packet_header));
+        send_packet(&FIN, s->sockfd, s->peer, sizeof(struct packet_header));
+    }
+    if(s->complete){
+        s->digest_match = confirm_digest(s);
+        if(s->digest_match == 0){
+            fprintf(stderr, "the receiver's CRC32C of the data doesn't match ours, it arrived corrupted\n");
+            s->complete = 0;
+        }
+    }
+    s->stats.finished_us = monotonic_us();
+    if(s->config.telemetry != NULL) emit_stats(s, s->stats.finished_us, 1);
+    release(s);
+    return s->complete;
+}
+
+void rdt_send_print_stats(const struct rdt_sender *s, FILE *out){
+    const struct rdt_send_stats *st = &s->stats;
+    uint64_t elapsed = st->finished_us > st->started_us ? st->finished_us - st->started_us : 0;
+    fprintf(out, "payload %d bytes per packet\n", s->payload_size);
+    fprintf(out, "sent %llu data packets, retransmitted %llu (%.2f%%): %llu fast, %llu timeouts\n", st->packets_sent,
+            st->retransmits, st->packets_sent ? 100.0 * st->retransmits / st->packets_sent : 0.0, st->fast_retransmits,
+            st->timeouts);
+    fprintf(out, "acks %llu, %llu duplicate, %llu window probes, largest cwnd %d packets\n", st->acks, st->dup_acks,
+            st->probes, st->cwnd_max);
+    if(s->resumed > 0) fprintf(out, "resumed: the receiver already had the first %llu bytes\n", s->resumed);
+    static const char *verdicts[] = {"not confirmed by the receiver", "does not match the receiver's", "matches the receiver's"};
+    fprintf(out, "data crc32c %08x (%s) %s\n", s->digest, crc32c_name(), verdicts[s->digest_match + 1]);
+    if(s->compress){
+        const struct compressor *c = &s->compressor;
+        fprintf(out, "compressed %llu bytes into %llu (%.1f%%), %llu of %llu blocks stored as is\n", c->raw_bytes,
+                c->wire_bytes, c->raw_bytes ? 100.0 * c->wire_bytes / c->raw_bytes : 0.0, c->stored, c->blocks);
+    }
+    if(s->fec_k > 0){
+        fprintf(out, "parity %llu packets, one per %d data packets, %s XOR\n", st->parity_sent, s->fec_k, fec_xor_name());
+    }
+    fprintf(out, "rtt p50 %lluus p90 %lluus p99 %lluus max %lluus over %llu samples\n",
+            (unsigned long long)histogram_percentile(&st->rtt, 50), (unsigned long long)histogram_percentile(&st->rtt, 90),
+            (unsigned long long)histogram_percentile(&st->rtt, 99), (unsigned long long)st->rtt.max,
+            (unsigned long long)st->rtt.total);
+    fprintf(out, "goodput %.1f Mbit/s over %.3fs\n", elapsed > 0 ? st->bytes_acked * 8.0 / elapsed : 0.0, elapsed / 1e6);
+    batch_io_print_stats(&s->batch, out);
+    if(s->pacer.mode != PACING_OFF){
+        fprintf(out, "pacing %s: last rate %llu bytes/s%s\n", s->pacer.mode == PACING_FIXED ? "fixed" : "cwnd/srtt",
+                (unsigned long long)s->pacer.rate, s->pacer.kernel ? ", SO_MAX_PACING_RATE set" : "");
+    }
+}
@@ -7,7 +7,6 @@
 @bugs no known bugs
 */
 
-#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,343 +14,387 @@
 #include <netinet/in.h>
 
 #include <sys/types.h>
-#include <sys/socket.h>
 #include <unistd.h>
 
-#include <pthread.h>
 #include <errno.h>
 
 
 #include <signal.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "clock.h"
+#include "rdt.h"
+
+#define WRITERATE 0       // default bytes/s written to the file, 0 for no limit
+#define MAX_REORDER_SIZE (1 << 20)
+#define MAX_WRITE_QUEUE_SIZE (1 << 16)
+#define MAX_STREAMS RDT_MAX_PORTS
+#define DAEMON_SESSIONS 1024                // default concurrent senders served by -d
+#define DAEMON_SESSION_MEMORY (4 << 20)     // default write queue bytes per session with -d
+
+struct rdt_recv_config config;
+int print_stats = 0;
+struct telemetry telemetry;     // -T: samples of every session as JSON lines
+int truncate_file = 1;          // 0 for a stream sharing the file with others
+int daemon_mode = 0;            // serve sessions into a directory until stopped
+int max_sessions = DAEMON_SESSIONS;
+const char *destination;        // the directory with daemon_mode
+struct rdt_receiver receiver;
+// the last transfer's totals, for rrecv's callers
+unsigned long long totalBytesReceived = 0;
+unsigned long long file_offset = 0;
 
-FILE *file;
-#define DATA_SIZE  508
-#define WRITERATE  508
-#define BUFFER_SIZE 520
 /*
-@brief packet structure, used to deserialize incoming packets
-*/
-struct packet {
-    int seq_num;
-    int data_len;
-    char data[DATA_SIZE];
-    int acked;
-};
-
-/*
-@brief ack packet structure, used to serialize and deserialize packets
-*/
-struct ack_packet {
-    int seq_num;
-};
-
-int last_received_seq = -1;
-int RWND_idx = 0;
-struct packet RWND[100];
-int totalBytesReceived = 0;
-int totalToReceive = 1;
+@brief the main function for reliably receiving data
 
+This is the main function of the receiver, it initiates connection
+with the sender, keeps receiving messages, writes data to file in
+order, and then terminates then closes when the sender is done 
+sending. A destination of - is standard output, which gets the data
+in order. A file keeps a resume journal next to it while it is being
+written, so if this process dies the sender's next try only sends
+what is missing.
 
+@param myUDPport: port number for the receiver to receive on
+@param destination file: the file to write the incoming data to
+@param writeRate: the maximum bytes/s to be written to the file
 
+@return 1 if every byte arrived, was stored and matched the sender's digest, 0 otherwise
+*/
+int rrecv(unsigned short int myUDPport, char* destinationFile, unsigned long long int writeRate) {
+    config.session.write_rate = writeRate;
+    config.max_sessions = 1;
+    if (rdt_receiver_init(&receiver, &config, myUDPport, 1) == 0) {
+        exit(EXIT_FAILURE);
+    }
 
-int compare(const void *a, const void *b) {
-    return ((struct packet*)a)->seq_num - ((struct packet*)b)->seq_num;
-}
+    // the writer is started by the handshake, once the payload size is known
+    int fd = STDOUT_FILENO;
+    char journal[PATH_MAX];
+    struct rdt_sink sink = rdt_sink_fd(fd);
+    if (strcmp(destinationFile, "-") != 0) {
+        // what an interrupted transfer left stays until the handshake shows whether it is the same file
+        resume_journal_path(journal, sizeof(journal), destinationFile);
+        int resuming = access(journal, F_OK) == 0;
+        fd = open(destinationFile, O_WRONLY | O_CREAT | (truncate_file && !resuming ? O_TRUNC : 0), 0644);
+        sink = rdt_sink_resumable(fd, journal);
+    }
+    if (fd < 0) {
+        perror("Failed to open file");
+        exit(EXIT_FAILURE);
+    }
 
-void sortArr(struct packet arr[]){
-    qsort(arr, RWND_idx, sizeof(struct packet), compare);
+    struct rdt_transfer result;
+    int ok = rdt_recv(&receiver, sink, &result);
+    totalBytesReceived = result.bytes_received;
+    file_offset = result.offset;
+    if (print_stats) {
+        uint64_t end = result.finished_us != 0 ? result.finished_us : monotonic_us();
+        double secs = result.started_us != 0 ? (end - result.started_us) / 1e6 : 0.0;
+        fprintf(stderr, "received %llu packets, %llu duplicate, %llu out of order, reorder peak %d packets\n",
+                result.packets_received, result.duplicates, result.out_of_order, result.reorder_peak);
+        if (result.resumed > 0) fprintf(stderr, "resumed: the first %llu bytes were already on disk\n", result.resumed);
+        if (result.fec_recovered > 0) fprintf(stderr, "rebuilt %llu lost packets from parity\n", result.fec_recovered);
+        if (result.corrupt > 0) fprintf(stderr, "dropped %llu packets that failed their CRC\n", result.corrupt);
+        fprintf(stderr, "data crc32c %08x %s\n", result.digest,
+                result.digest_match < 0 ? "not checked, the sender sent none" :
+                result.digest_match ? "matches the sender's" : "does NOT match the sender's");
+        fprintf(stderr, "goodput %.1f Mbit/s over %.3fs\n", secs > 0 ? result.bytes_received * 8.0 / secs / 1e6 : 0.0, secs);
+        rdt_receiver_print_stats(&receiver, stderr);
+    }
+    if (fd != STDOUT_FILENO) close(fd);
+    rdt_receiver_free(&receiver);
+    return ok;
 }
 
 /*
-@brief helper function to receive packets, deserializes the data coming on into the packet data structure
+@brief opens where a daemon session's data goes
 
-@param sockfd: socket information
-@param packet: a pointer to store the packet to be received
-@param sender_addr: the sender address to receive data from
-@param bytesReceived: a pointer to store the amount of bytes that have been received
+the sender's name is taken inside the directory, as long as it can't
+climb out of it, and the file is sized to the whole file's length.
+Streams of one file share it, each writes its own range, so it is
+never truncated below that length. A stream of unknown length is
+written from scratch unless it has a journal to resume from. Each
+session gets its own copy of the path and the resume journal's name,
+close_destination() frees them
 
-@return 0 in case of failure, 1 in case of success
+@param arg: unused
+@param transfer: what the sender asked for
+@param sink: where to store the file's sink
+
+@return 0 if the file can't be opened, 1 otherwise
 */
-int receive_packet(int sockfd, struct packet* packet, struct sockaddr_in* sender_addr, ssize_t *bytesReceived) {
-    char buffer[sizeof(*packet)]; // Correctly use sizeof(*packet) to get the size of the structure
-    socklen_t addr_len = sizeof(*sender_addr);
-    size_t size = 520;
-    *bytesReceived = recvfrom(sockfd, buffer,size , 0, (struct sockaddr*)sender_addr, &addr_len);
-
-    if (*bytesReceived < 0){
-        perror("recvfrom failed in receiver packets");
+int open_destination(void *arg, const struct rdt_transfer *transfer, struct rdt_sink *sink){
+    (void)arg;
+    char name[RDT_NAME_MAX];
+    if(transfer->name[0] == '\0' || transfer->name[0] == '.' || strchr(transfer->name, '/') != NULL){
+        snprintf(name, sizeof(name), "session-%d", transfer->conn_id);
+    } else {
+        snprintf(name, sizeof(name), "%s", transfer->name);
+    }
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", destination, name);
+    char journal[PATH_MAX];
+    resume_journal_path(journal, sizeof(journal), path);
+    int flags = O_WRONLY | O_CREAT;
+    if(transfer->file_length == 0 && access(journal, F_OK) < 0) flags |= O_TRUNC;
+    int fd = open(path, flags, 0644);
+    if(fd < 0){
+        perror("Failed to open file");
         return 0;
     }
-
-    // If the data is expected to be text, print the received text (ensure it's null-terminated)
-    buffer[*bytesReceived] = '\0'; // Make sure there's no buffer overflow here
-    
-    memcpy(packet, buffer, sizeof(*packet));
-   
-    return 1; // Success
+    if(transfer->file_length > 0 && ftruncate(fd, transfer->file_length) < 0){
+        perror("Failed to size file");
+    }
+    *sink = rdt_sink_resumable(fd, strdup(journal));
+    // a file sink leaves arg to its owner, it keeps the path for the log
+    sink->arg = strdup(path);
+    return 1;
 }
 
 /*
-@brief helper function to send packets, serializes packets to bytes to be sent
-
-@param packettosend: the packet to be sent
-@param sockfd: socket information
-@param receiver_addr: the receiver address to send data to
-@param buffer_size: the size of the data to be sent
+@brief logs a finished daemon session and closes its file
 
-@return 0 in case of failure, 1 in case of success
+@param arg: unused
+@param transfer: the transfer, with its totals
+@param sink: the file's sink
+@param ok: whether it all arrived
 */
-int send_packet(struct packet packettosend, int sockfd, struct sockaddr_in receiver_addr, size_t buffer_size){
-    char buffer[buffer_size];
-    memcpy(buffer, &packettosend, sizeof(packettosend));
-    receiver_addr.sin_family = AF_INET;
-    if (sendto(sockfd, buffer, buffer_size, 0, (const struct sockaddr *) &receiver_addr, sizeof(receiver_addr)) < 0) {
-            perror("failed to send\n");
-            return 0;
-        }
-    return 1;
-};
+void close_destination(void *arg, const struct rdt_transfer *transfer, struct rdt_sink *sink, int ok){
+    (void)arg;
+    double secs = ((transfer->finished_us != 0 ? transfer->finished_us : monotonic_us()) - transfer->started_us) / 1e6;
+    fprintf(stderr, "session %d from %s:%d: %llu of %llu bytes into %s at offset %llu in %.3fs%s%s\n",
+            transfer->conn_id, inet_ntoa(transfer->peer.sin_addr), ntohs(transfer->peer.sin_port), transfer->bytes_received,
+            transfer->bytes_expected, sink->arg != NULL ? (char *)sink->arg : "?", transfer->offset, secs,
+            transfer->resumed > 0 ? ", resumed" : "", ok ? "" : ", incomplete");
+    close(sink->fd);
+    free((char *)sink->journal);
+    free(sink->arg);
+}
 
 /*
-@brief helper function to send acks
-
-@param sockfd: socket information
-@param receiver_addr: the receiver address to send data to
-@param seq: the sequence number of the ack
+@brief handles SIGINT and SIGTERM: the daemon finishes its sessions' writes and exits
 
-@return 0 in case of failure, 1 in case of success
+@param sig: the signal
 */
-int send_ack(int sockfd, struct sockaddr_in receiver_addr , int seq){
-    struct ack_packet ack;
-    ack.seq_num = seq;
-    char buffer[sizeof(struct ack_packet)];
-    memcpy(buffer, &ack, sizeof(ack));
-    if (sendto(sockfd, buffer, sizeof(struct ack_packet), 0, (const struct sockaddr *) &receiver_addr, sizeof(receiver_addr)) < 0) {
-        perror("failed to send ack ");
-        return 0;
-    }
-    return 1;
+void stop_serving(int sig){
+    (void)sig;
+    rdt_receiver_stop(&receiver);
 }
 
-
 /*
-@brief Helper function to write packet data to file
+@brief serves any number of senders at once, until interrupted
 
-Writes data to file at a specified writeRate, 
-also modifies totalBytesReceived based on the amount of bytes written to file
+every session is written into the directory under the name its sender
+gave, with its own write queue capped at memory_cap bytes and its own
+write rate. All ports share one event loop
 
-@param packet: the packet to be written to file
-@param writeRate: the maximum write rate per second 
+@param myUDPport: the first port to receive on
+@param directory: where the files go
+@param writeRate: the maximum bytes/s written for each session
+@param ports: how many consecutive ports to listen on, for parallel streams
 
 @return 0 in case of failure, 1 in case of success
 */
-int write_packet_to_file(struct packet packet, int writeRate){
-    char buffer[DATA_SIZE];
-    char currBuffer[writeRate];
-    memcpy(buffer,&packet.data,sizeof(packet.data));
-    int bytesWritten = 0;
-    while(bytesWritten < packet.data_len){
-
-        if(writeRate == 0){
-            if (fwrite(buffer, 1, packet.data_len, file) != (packet.data_len)) {
-                perror("Failed to write to file");
-                return 0;
-            }
-            bytesWritten = packet.data_len;
-            fflush(file);
-        } else {
-            for(int i = 0 && i + bytesWritten < packet.data_len; i < writeRate; i++){
-                currBuffer[i] = buffer[bytesWritten + i];
-            }
-            time_t start_time = time(NULL); // curr time
-
-            int write_amt = writeRate;
-            if(bytesWritten + writeRate > packet.data_len){
-                write_amt = packet.data_len - bytesWritten;
-            } 
-            if (fwrite(currBuffer, 1, write_amt, file) != (write_amt)) {
-                perror("Failed to write to file");
-                return 0;
-            }
-            bytesWritten += write_amt;
-            fflush(file);
-            time_t end_time = time(NULL);
-            sleep(difftime(end_time, start_time));
-        }
+int rrecv_daemon(unsigned short int myUDPport, char* directory, unsigned long long int writeRate, int ports){
+    struct stat st;
+    if (stat(directory, &st) < 0 || !S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "%s is not a directory\n", directory);
+        return 0;
     }
-    totalBytesReceived += bytesWritten;
-    return 1;
+    config.session.write_rate = writeRate;
+    if (config.session.memory_cap == 0) config.session.memory_cap = DAEMON_SESSION_MEMORY;
+    config.max_sessions = max_sessions;
+    destination = directory;
+
+    if (rdt_receiver_init(&receiver, &config, myUDPport, ports) == 0) {
+        return 0;
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_serving;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    fprintf(stderr, "serving up to %d sessions on ports %d-%d into %s\n", max_sessions, myUDPport, myUDPport + ports - 1, directory);
+    int ok = rdt_serve(&receiver, open_destination, close_destination, NULL, 0);
+    if (print_stats) rdt_receiver_print_stats(&receiver, stderr);
+    rdt_receiver_free(&receiver);
+    return ok;
 }
 
+
 /*
-@brief helper function to initiate connection with the sender
+@brief receives several parallel streams into one file, one process per stream
 
-This function initiates the connection with the sender upon receiving 
-a packet with sequence number = -1, it send the write rate to the 
-sender and awaits an ack. After which the receiver will begin 
-receiving normally
+stream i is received on myUDPport + i from its own process, socket and
+core, and each writes its part of the file at the offset its sender
+announced. The file is truncated once up front, the write rate is
+shared evenly between the streams. The file is left as it is when a
+resume journal says an earlier try wrote part of it
 
-@param sockfd: socket information
-@param writeRate: the write rate to communicate to the sender
-@param sender_addr: the receiver address to send data to
+@param myUDPport: the first stream's port
+@param destinationFile: the file to write the incoming data to
+@param writeRate: the maximum bytes/s to be written to the file, for all streams together
+@param streams: the number of streams
 
 @return 0 in case of failure, 1 in case of success
 */
-int initiate_connection(int sockfd, int writeRate, struct sockaddr_in *sender_addr){
-
-    // set timeout
-    struct timeval tv;
-    tv.tv_sec = 5;
-    tv.tv_usec = 0; 
-    if (setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
-        perror("Error setting options");
+int rrecv_parallel(unsigned short int myUDPport, char* destinationFile, unsigned long long int writeRate, int streams){
+    char journal[PATH_MAX];
+    resume_journal_path(journal, sizeof(journal), destinationFile);
+    int fd = open(destinationFile, O_WRONLY | O_CREAT | (access(journal, F_OK) == 0 ? 0 : O_TRUNC), 0644);
+    if (fd < 0) {
+        perror("Failed to open file");
+        return 0;
     }
-
-    struct packet SYN_ACK;
-    SYN_ACK.seq_num = -1;
-    sprintf(SYN_ACK.data,"%d",writeRate);
-    SYN_ACK.acked = 0;
-    
-    while(1){
-        // check size (last argument)
-        if(send_packet(SYN_ACK, sockfd, *sender_addr, BUFFER_SIZE) == 0){
-            perror("failure to send write rate");
-        } 
-        char buffer[sizeof(struct ack_packet)];
-        socklen_t addr_len = sizeof(*sender_addr);
-        ssize_t bytesReceived = recvfrom(sockfd, buffer, sizeof(buffer), 0, (struct sockaddr*)sender_addr, &addr_len);
-
-        // check for timeout
-        if (bytesReceived >= 0) {
-            struct ack_packet received;
-            memcpy(&received,buffer,sizeof(buffer));
-            if(received.seq_num == -1){
-                return 1;
-            }     
+    close(fd);
+
+    uint64_t start = monotonic_us();
+    pid_t pids[MAX_STREAMS];
+    for(int i = 0; i < streams; i++){
+        fflush(stderr);
+        pids[i] = fork();
+        if(pids[i] < 0){
+            perror("fork failed");
+            streams = i;
+            break;
         }
-        else{
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // Timeout detected
-                perror("timeout");
-            } else{
-                perror("recvfrom failed");
-                return 0;
-            }
+        if(pids[i] == 0){
+            truncate_file = 0;
+            int ok = rrecv(myUDPport + i, destinationFile, writeRate / streams);
+            fprintf(stderr, "stream %d: %llu bytes at offset %llu\n", i, totalBytesReceived, file_offset);
+            exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
         }
     }
 
-    return 0; 
+    int ok = 1;
+    for(int i = 0; i < streams; i++){
+        int status;
+        if(waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) ok = 0;
+    }
+    struct stat st;
+    unsigned long long total = stat(destinationFile, &st) == 0 ? (unsigned long long)st.st_size : 0;
+    double secs = (monotonic_us() - start) / 1e6;
+    fprintf(stderr, "all %d streams: %llu bytes in %.3fs since start%s\n", streams, total, secs, ok ? "" : ", some streams failed");
+    return ok;
 }
 
 /*
-@brief the main function for reliably receiving data
+@brief closes the telemetry, registered with atexit() so the last line is
+written out on every way the process ends
+*/
+void close_telemetry(void) {
+    telemetry_close(&telemetry);
+}
 
-This is the main function of the receiver, it initiates connection
-with the sender, keeps receiving messages, writes data to file in
-order, and then terminates then closes when the sender is done 
-sending. 
+/*
+@brief prints the command line usage and exits
 
-@param myUDPport: port number for the receiver to receive on
-@param destination file: the file to write the incoming data to
-@param writeRate: the maximum bytes/s to be written to the file
+@param prog: the program name
 */
-void rrecv(unsigned short int myUDPport, char* destinationFile, unsigned long long int writeRate) {
-    int sockfd;
-    struct sockaddr_in my_addr;   
-
-    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sockfd == -1) {
-        perror("socket creation failed");
-        exit(EXIT_FAILURE);
-    }
+void usage(const char* prog) {
+    fprintf(stderr, "usage: %s [-r write_rate] [-b reorder_packets] [-q write_queue] [-m max_payload] [-n streams] [-a ack_every] [-t ack_delay_us] [-B batch_size] [-G] [-v] [-T stats_file|unix:socket] UDP_port filename_to_write|-\n"
+                    "       %s -d [-S max_sessions] [-M session_memory] [same options] UDP_port directory\n", prog, prog);
+    exit(EXIT_FAILURE);
+}
 
-    memset(&my_addr, 0, sizeof(my_addr));
-    my_addr.sin_family = AF_INET;
-    my_addr.sin_addr.s_addr = INADDR_ANY;
-    my_addr.sin_port = htons(myUDPport);
-    
-    if (bind(sockfd, (const struct sockaddr *)&my_addr, sizeof(my_addr)) < 0) {
-        perror("bind failed");
-        exit(EXIT_FAILURE);
+int main(int argc, char** argv) {
+    unsigned long long int writeRate = WRITERATE;
+    int streams = 1;
+    rdt_recv_config_default(&config);
+    int opt;
+    while ((opt = getopt(argc, argv, "r:b:q:m:n:a:t:B:GvT:dS:M:")) != -1) {
+        switch (opt) {
+            case 'r':
+                writeRate = strtoull(optarg, NULL, 10);
+                break;
+            case 'b':
+                config.session.reorder_size = atoi(optarg);
+                if (config.session.reorder_size < 1 || config.session.reorder_size > MAX_REORDER_SIZE) {
+                    fprintf(stderr, "reorder buffer must be between 1 and %d packets\n", MAX_REORDER_SIZE);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'q':
+                config.session.write_queue_size = atoi(optarg);
+                if (config.session.write_queue_size < 1 || config.session.write_queue_size > MAX_WRITE_QUEUE_SIZE) {
+                    fprintf(stderr, "write queue must be between 1 and %d packets\n", MAX_WRITE_QUEUE_SIZE);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'm':
+                config.session.max_payload = atoi(optarg);
+                if (config.session.max_payload < DATA_SIZE || config.session.max_payload > MAX_DATA_SIZE) {
+                    fprintf(stderr, "payload must be between %d and %d bytes\n", DATA_SIZE, MAX_DATA_SIZE);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'n':
+                streams = atoi(optarg);
+                if (streams < 1 || streams > MAX_STREAMS) {
+                    fprintf(stderr, "streams must be between 1 and %d\n", MAX_STREAMS);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'a':
+                config.session.ack_every = atoi(optarg);
+                if (config.session.ack_every < 1) usage(argv[0]);
+                break;
+            case 't':
+                config.session.ack_delay_us = strtoull(optarg, NULL, 10);
+                break;
+            case 'B':
+                config.batch_size = atoi(optarg);
+                if (config.batch_size < 1 || config.batch_size > MAX_BATCH_SIZE) {
+                    fprintf(stderr, "batch size must be between 1 and %d datagrams\n", MAX_BATCH_SIZE);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'G':
+                config.use_gro = 1;
+                break;
+            case 'v':
+                print_stats = 1;
+                break;
+            case 'T':
+                if (telemetry_open(&telemetry, optarg, TELEMETRY_INTERVAL_US) == 0) {
+                    exit(EXIT_FAILURE);
+                }
+                config.telemetry = &telemetry;
+                atexit(close_telemetry);
+                break;
+            case 'd':
+                daemon_mode = 1;
+                break;
+            case 'S':
+                max_sessions = atoi(optarg);
+                if (max_sessions < 1 || max_sessions > RDT_MAX_SESSIONS) {
+                    fprintf(stderr, "sessions must be between 1 and %d\n", RDT_MAX_SESSIONS);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'M':
+                config.session.memory_cap = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+        }
     }
-
-    file = fopen(destinationFile, "wb");
-    if (file == NULL) {
-        perror("Failed to open file");
-        exit(EXIT_FAILURE);
+    if (argc - optind != 2) {
+        usage(argv[0]);
     }
 
-    struct sockaddr_in sender_addr;
-    ssize_t bytesReceived;
-    while (totalBytesReceived < totalToReceive) {
-        struct packet curr_packet;
-        if(receive_packet(sockfd,&curr_packet,&sender_addr,&bytesReceived) == 0) continue;
-        
-        // handshake check
-        if(curr_packet.seq_num == - 2){
-            break;
-        }
-        if(curr_packet.seq_num == - 1){
-            totalToReceive = atoi(curr_packet.data);
-            initiate_connection(sockfd,  writeRate, &sender_addr);
-        }
-        else{
-            // acknowledge packet
-            send_ack(sockfd,sender_addr,curr_packet.seq_num);
-            // if packet already received send ack ^^ and continue to next packet
-            if(curr_packet.seq_num <= last_received_seq){
-                continue;
-            }
-            // make sure we're getting packets in order
-            if(curr_packet.seq_num != last_received_seq + 1){
-                RWND[RWND_idx] = curr_packet;
-                RWND_idx++;
-                sortArr(RWND);
-                continue;
-            } else {
-                last_received_seq++;
-            }
-            
-            if(RWND_idx == 0){
-                write_packet_to_file(curr_packet, writeRate);
-            } else {
-                write_packet_to_file(curr_packet, writeRate);
-               
-                for(int i = 0; i < RWND_idx; i++){
-                    // write the stuff in the window in order
-                    if(RWND[i].seq_num == last_received_seq + 1){
-                        write_packet_to_file(RWND[i], writeRate);
-                        last_received_seq++;
-                    } else{
-                        // make sure you bring them back so array starts from 0
-                        int last_index = i;
-                        for(int j = i; j < RWND_idx; j++){
-                            RWND[j - i] = RWND[j];
-                            last_index = j - i;
-                        }
-                        RWND_idx = last_index;
-                    }
-                }
-            }
-        }        
+    unsigned short int myUDPport = (unsigned short int)atoi(argv[optind]);
+    char* destinationFile = argv[optind + 1];
+    if (daemon_mode) {
+        return rrecv_daemon(myUDPport, destinationFile, writeRate, streams) ? EXIT_SUCCESS : EXIT_FAILURE;
     }
-
-    fclose(file);
-    close(sockfd);
-}
-
-
-int main(int argc, char** argv) {
-    if (argc != 3) {
-        fprintf(stderr, "usage: %s UDP_port filename_to_write\n", argv[0]);
-        exit(EXIT_FAILURE);
+    if (streams > 1) {
+        return rrecv_parallel(myUDPport, destinationFile, writeRate, streams) ? EXIT_SUCCESS : EXIT_FAILURE;
     }
-
-    unsigned short int myUDPport = (unsigned short int)atoi(argv[1]);
-    char* destinationFile = argv[2];
-    unsigned long long int writeRate = WRITERATE; 
-
-    rrecv(myUDPport, destinationFile, writeRate);
-
-    return EXIT_SUCCESS;
+    return rrecv(myUDPport, destinationFile, writeRate) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,136 @@
+/*
+@file reorder_buffer.c
+@brief sequence-indexed circular buffer for out of order packets at the receiver
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reorder_buffer.h"
+
+/*
+@brief the ring index of a sequence number
+
+@param rb: the buffer
+@param seq: the sequence number
+
+@return the slot index
+*/
+static inline int slot_index(const struct reorder_buffer *rb, long long seq){
+    return (int)(seq & (rb->capacity - 1));
+}
+
+int reorder_buffer_init(struct reorder_buffer *rb, int capacity, size_t slot_size, long long base){
+    int rounded = 64;
+    while(rounded < capacity) rounded <<= 1;
+
+    rb->slots = slot_size > 0 ? malloc(slot_size * rounded) : NULL;
+    rb->present = calloc(rounded / 64, sizeof(uint64_t));
+    if((slot_size > 0 && rb->slots == NULL) || rb->present == NULL){
+        perror("reorder buffer malloc failed");
+        free(rb->slots);
+        free(rb->present);
+        return 0;
+    }
+    rb->slot_size = slot_size;
+    rb->capacity = rounded;
+    rb->base = base;
+    rb->highest = base - 1;
+    rb->count = 0;
+    return 1;
+}
+
+void reorder_buffer_free(struct reorder_buffer *rb){
+    free(rb->slots);
+    free(rb->present);
+    rb->slots = NULL;
+    rb->present = NULL;
+}
+
+int reorder_buffer_insert(struct reorder_buffer *rb, long long seq, const void *data){
+    if(seq < rb->base) return 0;
+    if(seq - rb->base >= rb->capacity) return -1;
+    int idx = slot_index(rb, seq);
+    uint64_t bit = 1ULL << (idx & 63);
+    if(rb->present[idx >> 6] & bit) return 0;
+    rb->present[idx >> 6] |= bit;
+    rb->count++;
+    if(seq > rb->highest) rb->highest = seq;
+    if(rb->slot_size > 0 && data != NULL) memcpy(rb->slots + (size_t)idx * rb->slot_size, data, rb->slot_size);
+    return 1;
+}
+
+int reorder_buffer_contains(const struct reorder_buffer *rb, long long seq){
+    if(seq < rb->base || seq - rb->base >= rb->capacity) return 0;
+    int idx = slot_index(rb, seq);
+    return (rb->present[idx >> 6] >> (idx & 63)) & 1;
+}
+
+/*
+@brief finds the first sequence number in [from, to) whose presence bit equals want
+
+Works a bitmap word at a time, so long runs cost one step per 64 packets.
+
+@param rb: the buffer
+@param from: where to start, must be >= base
+@param to: where to stop, at most base + capacity
+@param want: 1 to find a buffered packet, 0 to find a gap
+
+@return the sequence number found, or to if there is none
+*/
+static long long scan_bits(const struct reorder_buffer *rb, long long from, long long to, int want){
+    while(from < to){
+        int idx = slot_index(rb, from);
+        uint64_t word = rb->present[idx >> 6];
+        if(!want) word = ~word;
+        word >>= (idx & 63);
+        if(word != 0){
+            long long found = from + __builtin_ctzll(word);
+            return found < to ? found : to;
+        }
+        from += 64 - (idx & 63);
+    }
+    return to;
+}
+
+int reorder_buffer_ready(const struct reorder_buffer *rb){
+    return (int)(scan_bits(rb, rb->base, rb->base + rb->capacity, 0) - rb->base);
+}
+
+int reorder_buffer_runs(const struct reorder_buffer *rb, long long *starts, long long *ends, int max){
+    int count = 0;
+    long long seq = rb->base;
+    long long to = rb->highest + 1;
+    while(count < max && seq < to){
+        long long start = scan_bits(rb, seq, to, 1);
+        if(start >= to) break;
+        long long end = scan_bits(rb, start, to, 0);
+        starts[count] = start;
+        ends[count] = end;
+        count++;
+        seq = end;
+    }
+    return count;
+}
+
+void *reorder_buffer_get(const struct reorder_buffer *rb, long long seq){
+    if(rb->slot_size == 0 || !reorder_buffer_contains(rb, seq)) return NULL;
+    return rb->slots + (size_t)slot_index(rb, seq) * rb->slot_size;
+}
+
+void *reorder_buffer_front(const struct reorder_buffer *rb){
+    return reorder_buffer_get(rb, rb->base);
+}
+
+void reorder_buffer_advance(struct reorder_buffer *rb){
+    int idx = slot_index(rb, rb->base);
+    uint64_t bit = 1ULL << (idx & 63);
+    if(rb->present[idx >> 6] & bit) rb->count--;
+    rb->present[idx >> 6] &= ~bit;
+    rb->base++;
+}
@@ -0,0 +1,125 @@
+/*
+@file reorder_buffer.h
+@brief sequence-indexed circular buffer for out of order packets at the receiver
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef REORDER_BUFFER_H
+#define REORDER_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+@brief buffer covering the sequence numbers [base, base + capacity)
+
+base is the next sequence number expected in order. A packet is stored
+in slot seq & (capacity - 1) and its presence is tracked in a bitmap,
+so inserting is O(1) and finding the packets that became deliverable is
+a scan over 64-bit bitmap words. With a slot size of 0 only the
+bitmap is kept, for callers that store the data elsewhere.
+*/
+struct reorder_buffer {
+    char *slots;
+    uint64_t *present;
+    size_t slot_size;
+    int capacity;           // a power of two, at least 64
+    long long base;
+    long long highest;      // highest sequence number ever buffered
+    int count;              // packets currently buffered
+};
+
+/*
+@brief allocates the buffer
+
+@param rb: the buffer to initialize
+@param capacity: how far past base packets are accepted, rounded up to a power of two
+@param slot_size: size of each stored packet in bytes, 0 to track presence only
+@param base: the first sequence number expected
+
+@return 0 in case of failure, 1 in case of success
+*/
+int reorder_buffer_init(struct reorder_buffer *rb, int capacity, size_t slot_size, long long base);
+
+/*
+@brief releases the buffer
+
+@param rb: the buffer
+*/
+void reorder_buffer_free(struct reorder_buffer *rb);
+
+/*
+@brief stores an out of order packet
+
+@param rb: the buffer
+@param seq: the packet's sequence number, must be >= base
+@param data: slot_size bytes to copy in, NULL to fill the slot in place, see reorder_buffer_get()
+
+@return 1 if stored, 0 if it was already buffered, -1 if seq is past the buffer's reach
+*/
+int reorder_buffer_insert(struct reorder_buffer *rb, long long seq, const void *data);
+
+/*
+@brief whether a sequence number is buffered
+
+@param rb: the buffer
+@param seq: the sequence number
+
+@return 1 if present, 0 otherwise
+*/
+int reorder_buffer_contains(const struct reorder_buffer *rb, long long seq);
+
+/*
+@brief counts the buffered packets that follow base without a gap
+
+@param rb: the buffer
+
+@return the length of the run of present packets starting at base
+*/
+int reorder_buffer_ready(const struct reorder_buffer *rb);
+
+/*
+@brief lists the runs of buffered packets past base, lowest first
+
+@param rb: the buffer
+@param starts: first sequence number of each run
+@param ends: one past the last sequence number of each run
+@param max: the most runs to report
+
+@return the number of runs stored
+*/
+int reorder_buffer_runs(const struct reorder_buffer *rb, long long *starts, long long *ends, int max);
+
+/*
+@brief the stored packet for a sequence number
+
+@param rb: the buffer
+@param seq: the sequence number
+
+@return the slot, or NULL if seq is not buffered or nothing is stored
+*/
+void *reorder_buffer_get(const struct reorder_buffer *rb, long long seq);
+
+/*
+@brief the stored packet for base
+
+@param rb: the buffer
+
+@return the slot, or NULL if base has not arrived or nothing is stored
+*/
+void *reorder_buffer_front(const struct reorder_buffer *rb);
+
+/*
+@brief moves base forward by one, dropping its slot if it was buffered
+
+Used both after delivering the front packet and when the base packet
+arrives in order and is delivered without being buffered.
+
+@param rb: the buffer
+*/
+void reorder_buffer_advance(struct reorder_buffer *rb);
+
+#endif
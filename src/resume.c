@@ -0,0 +1,171 @@
+/*
+@file resume.c
+@brief a journal next to a file of the byte ranges already safely on disk, so an interrupted transfer resumes
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "resume.h"
+
+/*
+@brief a range of bytes [start, end) on disk
+*/
+struct range {
+    unsigned long long start;
+    unsigned long long end;
+};
+
+/*
+@brief orders ranges by their start, for qsort()
+*/
+static int by_start(const void *a, const void *b){
+    const struct range *x = a;
+    const struct range *y = b;
+    return x->start < y->start ? -1 : x->start > y->start;
+}
+
+/*
+@brief reads a journal
+
+@param path: the journal
+@param file_length: where to store the file length it is for
+@param mtime: where to store the modification time it is for
+@param ranges: where to store its ranges, room for RESUME_MAX_RANGES
+
+@return the number of ranges, -1 if there is no journal or it can't be read
+*/
+static int load(const char *path, unsigned long long *file_length, long long *mtime, struct range *ranges){
+    FILE *f = fopen(path, "r");
+    if(f == NULL) return -1;
+    int count = 0;
+    if(fscanf(f, "rdt-resume %llu %lld", file_length, mtime) != 2){
+        count = -1;
+    } else {
+        while(count < RESUME_MAX_RANGES && fscanf(f, "%llu %llu", &ranges[count].start, &ranges[count].end) == 2){
+            if(ranges[count].start < ranges[count].end) count++;
+        }
+    }
+    fclose(f);
+    return count;
+}
+
+/*
+@brief writes a journal into a temporary file and renames it over the old one
+
+@param j: the journal
+@param ranges: its ranges, sorted and apart
+@param count: how many
+
+@return 0 in case of failure, 1 in case of success
+*/
+static int store(const struct resume_journal *j, const struct range *ranges, int count){
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", j->path);
+    FILE *f = fopen(tmp, "w");
+    if(f == NULL){
+        perror("Failed to write the resume journal");
+        return 0;
+    }
+    fprintf(f, "rdt-resume %llu %lld\n", j->file_length, j->mtime);
+    for(int i = 0; i < count; i++) fprintf(f, "%llu %llu\n", ranges[i].start, ranges[i].end);
+    int ok = fflush(f) == 0 && fdatasync(fileno(f)) == 0;
+    if(fclose(f) != 0) ok = 0;
+    if(!ok || rename(tmp, j->path) < 0){
+        perror("Failed to write the resume journal");
+        unlink(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+void resume_journal_path(char *path, size_t size, const char *file){
+    snprintf(path, size, "%s%s", file, RESUME_SUFFIX);
+}
+
+unsigned long long resume_begin(struct resume_journal *j, const char *path, int fd, unsigned long long file_length,
+                                long long mtime, unsigned long long offset, unsigned long long len){
+    memset(j, 0, sizeof(*j));
+    j->fd = fd;
+    j->file_length = file_length;
+    j->mtime = mtime;
+
+    struct range ranges[RESUME_MAX_RANGES];
+    unsigned long long had_length;
+    long long had_mtime;
+    flock(fd, LOCK_EX);
+    int count = load(path, &had_length, &had_mtime, ranges);
+    unsigned long long have = 0;
+    if(count >= 0 && file_length > 0 && mtime != 0 && had_length == file_length && had_mtime == mtime){
+        // only what the range starts with can be skipped, every packet goes at its offset from there
+        for(int i = 0; i < count; i++){
+            if(ranges[i].start <= offset && ranges[i].end > offset) have = ranges[i].end - offset;
+        }
+        if(have > len) have = len;
+        j->exists = 1;
+    } else if(access(path, F_OK) == 0){
+        // another file's journal, or a damaged one: the data is no use either
+        unlink(path);
+        if(ftruncate(fd, file_length > 0 ? file_length : offset) < 0) perror("Failed to truncate the stale file");
+    }
+    flock(fd, LOCK_UN);
+    if(file_length > 0 && mtime != 0) j->path = path;
+    j->start = offset + have;
+    return have;
+}
+
+int resume_record(struct resume_journal *j, unsigned long long end){
+    if(j->path == NULL) return 1;
+    struct range ranges[RESUME_MAX_RANGES + 1];
+    unsigned long long had_length;
+    long long had_mtime;
+    flock(j->fd, LOCK_EX);
+    int count = load(j->path, &had_length, &had_mtime, ranges);
+    if(count < 0 || had_length != j->file_length || had_mtime != j->mtime) count = 0;
+    if(end > j->start){
+        ranges[count].start = j->start;
+        ranges[count].end = end;
+        count++;
+    }
+
+    // merge what overlaps or touches, the highest range goes if they still don't fit
+    qsort(ranges, count, sizeof(ranges[0]), by_start);
+    int merged = 0;
+    for(int i = 0; i < count; i++){
+        if(merged > 0 && ranges[i].start <= ranges[merged - 1].end){
+            if(ranges[i].end > ranges[merged - 1].end) ranges[merged - 1].end = ranges[i].end;
+        } else {
+            ranges[merged++] = ranges[i];
+        }
+    }
+    if(merged > RESUME_MAX_RANGES) merged = RESUME_MAX_RANGES;
+
+    int ok = 1;
+    if(merged == 1 && ranges[0].start == 0 && ranges[0].end >= j->file_length){
+        // the whole file is here
+        if(unlink(j->path) < 0 && errno != ENOENT) perror("Failed to remove the resume journal");
+        j->exists = 0;
+    } else {
+        ok = store(j, ranges, merged);
+        if(ok) j->exists = 1;
+    }
+    flock(j->fd, LOCK_UN);
+    return ok;
+}
+
+void resume_discard(struct resume_journal *j){
+    if(j->path == NULL) return;
+    flock(j->fd, LOCK_EX);
+    if(unlink(j->path) < 0 && errno != ENOENT) perror("Failed to remove the resume journal");
+    flock(j->fd, LOCK_UN);
+    j->exists = 0;
+}
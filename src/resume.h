@@ -0,0 +1,91 @@
+/*
+@file resume.h
+@brief a journal next to a file of the byte ranges already safely on disk, so an interrupted transfer resumes
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef RESUME_H
+#define RESUME_H
+
+#include <stddef.h>
+
+#define RESUME_SUFFIX ".resume"         // the journal's name is the file's with this appended
+#define RESUME_MAX_RANGES 256           // ranges kept, past a gap a session only ever adds its own
+#define RESUME_INTERVAL_US 1000000ULL   // how often a session puts what it wrote on disk and in the journal
+#define RESUME_MARK_BYTES (4ULL << 20)  // in order bytes between the points the writer may record
+
+/*
+@brief one session's view of the journal of the file it writes
+
+The journal is a short text file: the sender's file length and
+modification time, then one line per range of bytes that were synced
+to disk. It is rewritten whole into a temporary file and renamed over
+the old one, so a crash leaves either of them and never half of one.
+Every session writing the file, in this process or another, holds the
+file's flock() while it reads and rewrites the journal, and merges its
+own range into what is there. A journal for a different file length
+or modification time is stale, and the transfer starts over.
+
+Once the ranges cover the whole file the journal is removed.
+*/
+struct resume_journal {
+    const char *path;               // NULL when the transfer can't be resumed
+    int fd;                         // the data file, its lock guards the journal
+    unsigned long long file_length;
+    long long mtime;
+    unsigned long long start;       // where this session's range starts, past what was already on disk
+    int exists;                     // 1 once the journal on disk is this transfer's
+};
+
+/*
+@brief the journal's name for a file
+
+@param path: where to store it
+@param size: the room there
+@param file: the file's name
+*/
+void resume_journal_path(char *path, size_t size, const char *file);
+
+/*
+@brief reads the journal when a session starts, or clears a stale one
+
+A journal that doesn't match the sender's file is removed and the file
+truncated to the sender's length, or to offset when that is unknown, so
+none of the old data survives past what this transfer writes.
+
+@param j: the session's journal
+@param path: the journal, it must stay valid for the session
+@param fd: the data file
+@param file_length: the sender's whole file length, 0 if unknown
+@param mtime: the sender's file modification time in nanoseconds, 0 if unknown
+@param offset: where the sender's range starts
+@param len: its length
+
+@return how many bytes from offset on are already on disk, 0 if the transfer can't be resumed
+*/
+unsigned long long resume_begin(struct resume_journal *j, const char *path, int fd, unsigned long long file_length,
+                                long long mtime, unsigned long long offset, unsigned long long len);
+
+/*
+@brief adds the session's range up to end to the journal, once the data in it is synced to disk
+
+Called after fdatasync(), from the writer thread while it runs.
+
+@param j: the session's journal
+@param end: the end of the bytes on disk, from j->start on
+
+@return 0 in case of failure, 1 in case of success
+*/
+int resume_record(struct resume_journal *j, unsigned long long end);
+
+/*
+@brief removes the journal, the data on disk is not to be trusted
+
+@param j: the session's journal
+*/
+void resume_discard(struct resume_journal *j);
+
+#endif
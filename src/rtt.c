@@ -0,0 +1,55 @@
+/*
+@file rtt.c
+@brief round trip time estimation and retransmission timeout (RFC 6298)
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include "rtt.h"
+
+/*
+@brief clamps a timeout into [RTO_MIN_US, RTO_MAX_US]
+
+@param rto_us: the unclamped timeout
+
+@return the clamped timeout
+*/
+static uint64_t rtt_clamp(uint64_t rto_us){
+    if(rto_us < RTO_MIN_US) return RTO_MIN_US;
+    if(rto_us > RTO_MAX_US) return RTO_MAX_US;
+    return rto_us;
+}
+
+void rtt_init(struct rtt_estimator *est, uint64_t initial_rto_us){
+    est->srtt_us = 0;
+    est->rttvar_us = 0;
+    est->rto_us = rtt_clamp(initial_rto_us);
+    est->backoffs = 0;
+}
+
+void rtt_sample(struct rtt_estimator *est, uint64_t sample_us){
+    if(est->srtt_us == 0){
+        est->srtt_us = sample_us;
+        est->rttvar_us = sample_us / 2;
+    } else {
+        // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R
+        uint64_t err = est->srtt_us > sample_us ? est->srtt_us - sample_us : sample_us - est->srtt_us;
+        est->rttvar_us = (3 * est->rttvar_us + err) / 4;
+        est->srtt_us = (7 * est->srtt_us + sample_us) / 8;
+    }
+    uint64_t var = 4 * est->rttvar_us;
+    if(var < RTO_GRANULARITY_US) var = RTO_GRANULARITY_US;
+    est->rto_us = rtt_clamp(est->srtt_us + var);
+    est->backoffs = 0;
+}
+
+int rtt_backoff(struct rtt_estimator *est){
+    est->rto_us = rtt_clamp(est->rto_us * 2);
+    return ++est->backoffs;
+}
+
+uint64_t rtt_rto(const struct rtt_estimator *est){
+    return est->rto_us;
+}
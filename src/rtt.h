@@ -0,0 +1,69 @@
+/*
+@file rtt.h
+@brief round trip time estimation and retransmission timeout (RFC 6298)
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef RTT_H
+#define RTT_H
+
+#include <stdint.h>
+
+#define RTO_INITIAL_US 1000000ULL   // before the first sample, RFC 6298 2.1
+#define RTO_HANDSHAKE_US 50000ULL   // the handshake's first timeout, a lost SYN costs milliseconds
+#define RTO_MIN_US 2000ULL          // lets a LAN recover in a few RTTs
+#define RTO_MAX_US 60000000ULL
+#define RTO_GRANULARITY_US 1000ULL
+#define RTO_MAX_RETRIES 10          // consecutive timeouts before giving up on the peer
+
+/*
+@brief smoothed RTT state, all times in microseconds
+*/
+struct rtt_estimator {
+    uint64_t srtt_us;
+    uint64_t rttvar_us;
+    uint64_t rto_us;
+    int backoffs;
+};
+
+/*
+@brief initializes an estimator with no samples
+
+@param est: the estimator
+@param initial_rto_us: the timeout to use until the first sample arrives
+*/
+void rtt_init(struct rtt_estimator *est, uint64_t initial_rto_us);
+
+/*
+@brief adds an RTT measurement and recomputes the timeout
+
+Callers must follow Karn's rule and only sample packets that were
+never retransmitted. A valid sample also clears any backoff.
+
+@param est: the estimator
+@param sample_us: the measured round trip time
+*/
+void rtt_sample(struct rtt_estimator *est, uint64_t sample_us);
+
+/*
+@brief doubles the timeout after it expired, up to RTO_MAX_US
+
+@param est: the estimator
+
+@return the number of consecutive backoffs so far
+*/
+int rtt_backoff(struct rtt_estimator *est);
+
+/*
+@brief the current retransmission timeout
+
+@param est: the estimator
+
+@return the timeout in microseconds
+*/
+uint64_t rtt_rto(const struct rtt_estimator *est);
+
+#endif
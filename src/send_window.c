@@ -0,0 +1,110 @@
+/*
+@file send_window.c
+@brief preallocated ring buffer holding the sender's unacked packets
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "send_window.h"
+
+/*
+@brief the ring index of a sequence number
+
+@param window: the window
+@param seq: the sequence number
+
+@return the slot index
+*/
+static inline int slot_index(const struct send_window *window, long long seq){
+    return (int)(seq & (window->capacity - 1));
+}
+
+int send_window_init(struct send_window *window, int capacity, size_t slot_size, long long first_seq){
+    int rounded = 64;
+    while(rounded < capacity) rounded <<= 1;
+
+    window->slots = malloc(slot_size * rounded);
+    window->acked = calloc(rounded / 64, sizeof(uint64_t));
+    if(window->slots == NULL || window->acked == NULL){
+        perror("send window malloc failed");
+        free(window->slots);
+        free(window->acked);
+        return 0;
+    }
+    window->slot_size = slot_size;
+    window->capacity = rounded;
+    window->base = first_seq;
+    window->next = first_seq;
+    return 1;
+}
+
+void send_window_free(struct send_window *window){
+    free(window->slots);
+    free(window->acked);
+    window->slots = NULL;
+    window->acked = NULL;
+}
+
+int send_window_count(const struct send_window *window){
+    return (int)(window->next - window->base);
+}
+
+void *send_window_push(struct send_window *window, long long *seq){
+    if(send_window_count(window) == window->capacity) return NULL;
+    int idx = slot_index(window, window->next);
+    window->acked[idx >> 6] &= ~(1ULL << (idx & 63));
+    if(seq != NULL) *seq = window->next;
+    window->next++;
+    return window->slots + (size_t)idx * window->slot_size;
+}
+
+void *send_window_get(const struct send_window *window, long long seq){
+    if(seq < window->base || seq >= window->next) return NULL;
+    return window->slots + (size_t)slot_index(window, seq) * window->slot_size;
+}
+
+int send_window_is_acked(const struct send_window *window, long long seq){
+    if(seq < window->base || seq >= window->next) return 0;
+    int idx = slot_index(window, seq);
+    return (window->acked[idx >> 6] >> (idx & 63)) & 1;
+}
+
+int send_window_ack_range(struct send_window *window, long long start, long long end,
+                          void (*on_acked)(long long seq, void *ctx), void *ctx){
+    if(start < window->base) start = window->base;
+    if(end > window->next) end = window->next;
+    int newly = 0;
+    while(start < end){
+        // the part of the range that falls in this bitmap word
+        int idx = slot_index(window, start);
+        int shift = idx & 63;
+        long long span = 64 - shift;
+        if(span > end - start) span = end - start;
+        uint64_t mask = (span == 64 ? ~0ULL : ((1ULL << span) - 1)) << shift;
+
+        uint64_t fresh = mask & ~window->acked[idx >> 6];
+        window->acked[idx >> 6] |= mask;
+        newly += __builtin_popcountll(fresh);
+        while(fresh != 0 && on_acked != NULL){
+            int bit = __builtin_ctzll(fresh);
+            on_acked(start + (bit - shift), ctx);
+            fresh &= fresh - 1;
+        }
+        start += span;
+    }
+    return newly;
+}
+
+int send_window_advance(struct send_window *window){
+    int released = 0;
+    while(window->base < window->next && send_window_is_acked(window, window->base)){
+        window->base++;
+        released++;
+    }
+    return released;
+}
@@ -0,0 +1,115 @@
+/*
+@file send_window.h
+@brief preallocated ring buffer holding the sender's unacked packets
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef SEND_WINDOW_H
+#define SEND_WINDOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+@brief a window over the sequence numbers [base, next)
+
+Slots are allocated once as a single slab and addressed by
+seq & (capacity - 1), so lookups, acks and sliding are O(1) and no
+memory is allocated per packet. The slot contents are opaque to the
+window; only the acked bits are kept here, one bitmap word covers 64
+packets so acking a whole SACK range costs a word operation per 64.
+*/
+struct send_window {
+    char *slots;
+    uint64_t *acked;
+    size_t slot_size;
+    int capacity;           // a power of two, at least 64
+    long long base;         // oldest packet still in the window
+    long long next;         // sequence number of the next packet pushed
+};
+
+/*
+@brief allocates the window's slab
+
+@param window: the window to initialize
+@param capacity: the most packets it can hold, rounded up to a power of two
+@param slot_size: size of each slot in bytes
+@param first_seq: the sequence number of the first packet that will be pushed
+
+@return 0 in case of failure, 1 in case of success
+*/
+int send_window_init(struct send_window *window, int capacity, size_t slot_size, long long first_seq);
+
+/*
+@brief releases the window's slab
+
+@param window: the window
+*/
+void send_window_free(struct send_window *window);
+
+/*
+@brief the number of packets in the window, acked or not
+
+@param window: the window
+
+@return next - base
+*/
+int send_window_count(const struct send_window *window);
+
+/*
+@brief claims the slot for the next sequence number
+
+@param window: the window
+@param seq: where to store the slot's sequence number, may be NULL
+
+@return the slot, or NULL if the window is full
+*/
+void *send_window_push(struct send_window *window, long long *seq);
+
+/*
+@brief looks up a packet still in the window
+
+@param window: the window
+@param seq: the sequence number
+
+@return the slot, or NULL if seq is outside [base, next)
+*/
+void *send_window_get(const struct send_window *window, long long seq);
+
+/*
+@brief whether a packet in the window was acked
+
+@param window: the window
+@param seq: the sequence number
+
+@return 1 if acked, 0 if unacked or outside the window
+*/
+int send_window_is_acked(const struct send_window *window, long long seq);
+
+/*
+@brief marks every packet in [start, end) acked
+
+@param window: the window
+@param start: first sequence number of the range
+@param end: one past the last sequence number, clamped to the window
+@param on_acked: called once for each packet that was not acked before, may be NULL
+@param ctx: passed through to on_acked
+
+@return the number of packets newly acked
+*/
+int send_window_ack_range(struct send_window *window, long long start, long long end,
+                          void (*on_acked)(long long seq, void *ctx), void *ctx);
+
+/*
+@brief slides the window past the acked packets at its start
+
+@param window: the window
+
+@return the number of slots released
+*/
+int send_window_advance(struct send_window *window);
+
+#endif
@@ -8,353 +8,231 @@
 */
 
 
+#define _GNU_SOURCE // for basename
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
     #include <netinet/in.h>
 
 #include <sys/types.h>
-#include <sys/socket.h>
 #include <unistd.h>
 
-#include <pthread.h>
 #include <errno.h>
 
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <fcntl.h> // for opening file
+#include <sys/stat.h>
+#include <sys/wait.h>
 
-#define DATA_SIZE 508
-#define BUFFER_SIZE 520
-#define MAX_CWND_SIZE 100 
+#include "clock.h"
+#include "rdt.h"
 
-int packet_size = 0;
-int CWND_size = 0;
-int num_CWND_occupied = 0;
-int pack_num = -1;
-int bytesTransferring = 0;
+#define MAX_WINDOW_LIMIT (1 << 20)
+#define MAX_STREAMS RDT_MAX_PORTS
 
-/*
-@brief packet structure, used to deserialize incoming packets
-*/
-struct packet {
-    int seq_num;
-    int data_len;
-    char data[DATA_SIZE];
-    int acked;  
-};
+struct rdt_send_config config;
+int print_stats = 0;
+struct telemetry telemetry;     // -T: samples of the transfer as JSON lines
 
 /*
-@brief ack packet structure, used to serialize and deserialize packets
-*/
-struct ack_packet {
-    int seq_num;
-};
-
-
-/*
-@brief helper function to send packets, serializes packets to bytes to be sent
-
-@param packettosend: the packet to be sent
-@param sockfd: socket information
-@param receiver_addr: the receiver address to send data to
-@param packet_size: the size of the data to be sent
-
-@return 0 in case of failure, 1 in case of success
-*/
-int send_packet(struct packet packettosend, int sockfd, struct sockaddr_in receiver_addr, size_t packet_size){
-    char buffer[packet_size];
-    memcpy(buffer, &packettosend, sizeof(packettosend));
-    if (sendto(sockfd, buffer, BUFFER_SIZE, 0, (const struct sockaddr *) &receiver_addr, sizeof(receiver_addr)) < 0) {
-            perror("send packet failed");
-            return 0;
-        }
-    return 1;
-};
-
+@brief the main function for reliably sending data
 
-/*
-@brief helper function to handle timeouts
+This is the main function of the sender, it initiates connection
+with the receiver, reads data from file, and sends the data to 
+the receiver while handling dropped messages. A filename of - is
+standard input, read as it comes.
 
-goes through the congestion window, resends any un-acked
-packets
+@param hostname: the current host address
+@param myUDPport: port number for the receiver to receive on
+@param filename: the file to read the data from
+@param bytesToTransfer: tthe amount of bytes to send
 
-@param CWND: the congestion window array
-@param sockfd: socket information
-@param receiver_addr: the receiver address to send data to
+@return 1 if every byte was acked and the receiver's digest matched, 0 otherwise
 */
-void handle_timeout(struct packet *CWND[], int sockfd, struct sockaddr_in receiver_addr){
-    for(size_t i = 0; i < num_CWND_occupied; i++){
-        // check if packet in window is acked, otherwise resend
-        if(CWND[i]->acked == 0){
-            if(send_packet(*CWND[i], sockfd, receiver_addr, BUFFER_SIZE) == 0){
-                perror(" error resending packet");
-            }
-        }
+int rsend(char* hostname, unsigned short int hostUDPport, char* filename, unsigned long long int bytesToTransfer) {
+    int fd = STDIN_FILENO;
+    // GNU basename, from string.h: it leaves filename alone
+    config.name = NULL;
+    if (strcmp(filename, "-") != 0) {
+        fd = open(filename, O_RDONLY);
+        config.name = basename(filename);
+    }
+    if (fd < 0) {
+        perror("Failed to open file");
+        exit(EXIT_FAILURE);
     }
+
+    struct rdt_sender sender;
+    sender.config = config;
+    int complete = rdt_send(&sender, hostname, hostUDPport, rdt_source_fd(fd), bytesToTransfer);
+    if (print_stats) rdt_send_print_stats(&sender, stderr);
+    if (fd != STDIN_FILENO) close(fd);
+    return complete;
 }
 
+
 /*
-@brief helper function to handle receiving acks
+@brief sends a file as several parallel streams, one process per stream
 
-marks packets as acked and slides the congestion 
-window if needed
+The file is cut into equal byte ranges and stream i sends its range to
+hostUDPport + i, each from its own process, socket and core. Every
+stream's SYN tells the receiver where its range starts, so the
+receiver writes them all into one file by offset. Each stream reports
+its own throughput, the parent the aggregate
 
-@param CWND: the congestion window array
-@param ack_seq_num: the sequence number of the incoming ack
+@param hostname: the receiver's address
+@param hostUDPport: the first stream's port
+@param filename: the file to read the data from, must be a regular file
+@param bytesToTransfer: the amount of bytes to send
+@param streams: the number of streams
 
 @return 0 in case of failure, 1 in case of success
 */
-void handle_ack_recv(struct packet *CWND[], int ack_seq_num){
-    for(int i = 0; i < num_CWND_occupied; i++){
-        if(CWND[i]->seq_num == ack_seq_num){
-            CWND[i]->acked = 1;
+int rsend_parallel(char* hostname, unsigned short int hostUDPport, char* filename, unsigned long long int bytesToTransfer, int streams){
+    struct stat st;
+    if(stat(filename, &st) < 0 || !S_ISREG(st.st_mode)){
+        fprintf(stderr, "parallel streams need a regular file to split\n");
+        return 0;
+    }
+    unsigned long long total = bytesToTransfer < (unsigned long long)st.st_size ? bytesToTransfer : (unsigned long long)st.st_size;
+
+    uint64_t start = monotonic_us();
+    pid_t pids[MAX_STREAMS];
+    for(int i = 0; i < streams; i++){
+        unsigned long long first = total * i / streams;
+        unsigned long long last = total * (i + 1) / streams;
+        fflush(stderr);
+        pids[i] = fork();
+        if(pids[i] < 0){
+            perror("fork failed");
+            streams = i;
             break;
         }
-    }
-
-    int num_acked = 0;
-    for(int i = 0; i < num_CWND_occupied; i++){
-        if(CWND[i]->acked == 1){
-            free(CWND[i]);
-            num_acked++;
+        if(pids[i] == 0){
+            config.range_offset = first;
+            config.file_length = total;
+            uint64_t began = monotonic_us();
+            int complete = rsend(hostname, hostUDPport + i, filename, last - first);
+            double secs = (monotonic_us() - began) / 1e6;
+            fprintf(stderr, "stream %d: %llu bytes at offset %llu in %.3fs, %.1f MB/s%s\n", i, last - first, first, secs,
+                    secs > 0 ? (last - first) / secs / 1e6 : 0.0, complete ? "" : ", incomplete");
+            exit(complete ? EXIT_SUCCESS : EXIT_FAILURE);
         }
-        else break;
     }
 
-    for(int i = num_acked; i < num_CWND_occupied; i++){
-        CWND[i - num_acked] = CWND[i];
+    int ok = 1;
+    for(int i = 0; i < streams; i++){
+        int status;
+        if(waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) ok = 0;
     }
-    num_CWND_occupied -= num_acked;
+    double secs = (monotonic_us() - start) / 1e6;
+    fprintf(stderr, "all %d streams: %llu bytes in %.3fs, %.1f MB/s%s\n", streams, total, secs,
+            secs > 0 ? total / secs / 1e6 : 0.0, ok ? "" : ", some streams failed");
+    return ok;
 }
 
 /*
-@brief helper function to receive packets, deserializes the data coming on into the packet data structure
-
-@param sockfd: socket information
-@param packet: a pointer to store the packet to be received
-@param sender_addr: the sender address to receive data from
-
-@return 0 in case of failure, 1 in case of success
+@brief closes the telemetry, registered with atexit() so the last line is
+written out on every way the process ends
 */
-int receive_packet(int sockfd, struct packet* packet, struct sockaddr_in* sender_addr) {
-    char buffer[sizeof(*packet)]; // Correctly use sizeof(*packet) to get the size of the structure
-    socklen_t addr_len = sizeof(*sender_addr);
-    printf("%s : %d\n", inet_ntoa(sender_addr->sin_addr),ntohs(sender_addr->sin_port));
-    ssize_t bytesReceived = recvfrom(sockfd, buffer, sizeof(buffer), 0,
-                                     (struct sockaddr*) sender_addr, &addr_len);
-    if (bytesReceived < 0) {
-        perror("recvfrom failed");
-        return 0;
-    }
-
-    memcpy(packet, buffer, sizeof(*packet));
-    return 1; // Success
+void close_telemetry(void) {
+    telemetry_close(&telemetry);
 }
 
 /*
-initiates connection with receiver, returns the packet size and congestion window size to be used
-*/
-
-/*
-@brief helper function to initiate connection with the receiver
-
-This function initiates the connection with the receiver, it 
-sends the expected bytesToTransfer to the receiver. Sets the 
-packet size and congestion window size based on receiver write
-rate.
+@brief prints the command line usage and exits
 
-@param sockfd: socket information
-@param receiver_addr: the receiver address to send/receive data
-@param SYN_size: size of the SYN packet
-
-@return 0 in case of failure, 1 in case of success
+@param prog: the program name
 */
-int initiate_connection(int sockfd, struct sockaddr_in* receiver_addr, size_t SYN_size){
-    // send SYN message
-    struct packet SYN; 
-    SYN.seq_num = pack_num;
-    SYN.acked = 0;
-    SYN.data_len = SYN_size;
-    sprintf(SYN.data,"%d",bytesTransferring);
-    // advance global sequence number 
-    pack_num++;
-   
-    // send initiation packet
-    if(send_packet(SYN, sockfd, *receiver_addr, SYN_size) == 0){
-        perror("Failure to send SYN");
-    }
-    // receive packet with writeRate
-    struct packet write_rate_packet;
-    while(1){
-        if(receive_packet(sockfd, &write_rate_packet, receiver_addr) == 0){
-            perror("failure receiving write rate");
-        } else {
-            break;  
-        }
-    }
-
-    // deserialize write rate, figure out the congestion window and packet size
-    int write_rate = atoi(write_rate_packet.data);
-    // CWND calculation
-    packet_size = 520; // 508 data plus three ints
-    if(write_rate == 0){
-        CWND_size = MAX_CWND_SIZE;
-    } else {
-        if(write_rate / packet_size < 1) CWND_size = 1;
-        else CWND_size = write_rate / packet_size;
-    }
-
-    // send ack
-    struct ack_packet ack;
-    ack.seq_num = write_rate_packet.seq_num;
-
-    char buffer[sizeof(struct ack_packet)];
-    memcpy(buffer, &ack, sizeof(ack));
-    
-    if (sendto(sockfd, buffer, packet_size, 0, (const struct sockaddr *) receiver_addr, sizeof(*receiver_addr)) < 0) {
-        perror("failed to send ack");
-    }
-    return 1;
+void usage(const char* prog) {
+    fprintf(stderr, "usage: %s [-c reno|cubic|bbr] [-p | -P pacing_rate] [-w window_packets] [-m max_payload] [-n streams] [-B batch_size] [-G] [-F parity_block] [-z] [-v] [-T stats_file|unix:socket] receiver_hostname receiver_port filename_to_xfer|- bytes_to_xfer\n", prog);
+    exit(EXIT_FAILURE);
 }
 
-/*
-@brief the main function for reliably sending data
-
-This is the main function of the sender, it initiates connection
-with the receiver, reads data from file, and sends the data to 
-the receiver while handling dropped messages. 
-
-@param hostname: the current host address
-@param myUDPport: port number for the receiver to receive on
-@param filename: the file to read the data from
-@param bytesToTransfer: tthe amount of bytes to send
-*/
-void rsend(char* hostname, unsigned short int hostUDPport, char* filename, unsigned long long int bytesToTransfer) {
-    bytesTransferring = bytesToTransfer;
-    int sockfd;
-    struct sockaddr_in receiver_addr;
-    char buffer[DATA_SIZE];
-    FILE *file;
-
-    // Create socket
-    if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
-        perror("socket creation failed");
-        exit(EXIT_FAILURE);
-    }
-    // set timeout
-    struct timeval tv;
-    tv.tv_sec = 5;
-    tv.tv_usec = 0; 
-    if (setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
-        perror("Error setting options");
-    }
-    memset(&receiver_addr, 0, sizeof(receiver_addr));
-
-    // Filling server information
-    receiver_addr.sin_family = AF_INET;
-    receiver_addr.sin_port = htons(hostUDPport);
-    receiver_addr.sin_addr.s_addr = inet_addr(hostname); // Convert IPv4 addresses from text to binary form
-    if (inet_pton(AF_INET, hostname, &receiver_addr.sin_addr) <= 0) {
-        perror("Invalid address/ Address not supported");
-        close(sockfd);
-        exit(EXIT_FAILURE);
-    }
-
-    // Open the file
-    file = fopen(filename, "rb");
-    if (file == NULL) {
-        perror("Failed to open file");
-        exit(EXIT_FAILURE);
-    }
-
-    // establish connection with receiver
-    size_t SYN_size = 516; 
-    initiate_connection(sockfd, &receiver_addr, SYN_size);
-
-    struct packet *CWND[CWND_size];
-
-    // Read and send the file in chunks
-    unsigned long long int bytesSent = 0;
-    while (bytesSent < bytesToTransfer && !feof(file)) {
-        // if buffer is full or file ended/all data sent, wait for ack/timeout
-        if(num_CWND_occupied == CWND_size || bytesSent >= bytesToTransfer){
-            // wait for ack/timeout
-            char buffer[sizeof(struct ack_packet)];
-            socklen_t addr_len = sizeof(receiver_addr);
-            ssize_t bytesReceived = recvfrom(sockfd, buffer, sizeof(buffer), 0, (struct sockaddr*)&receiver_addr, &addr_len);
-            if (bytesReceived >= 0) {
-                struct ack_packet received;
-                memcpy(&received,buffer,sizeof(buffer));
-
-                handle_ack_recv(CWND, received.seq_num);
-            }else {
-                // check timeout
-                if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                    // Timeout detected
-                    handle_timeout(CWND, sockfd, receiver_addr);
-                } else{
-                    perror("recvfrom failed");
+int main(int argc, char** argv) {
+    int streams = 1;
+    int opt;
+    rdt_send_config_default(&config);
+    while ((opt = getopt(argc, argv, "c:pP:w:m:n:B:GF:zvT:")) != -1) {
+        switch (opt) {
+            case 'c':
+                if (cc_parse(optarg, &config.cc_algo) == 0) {
+                    fprintf(stderr, "unknown congestion control '%s', expected reno, cubic or bbr\n", optarg);
+                    exit(EXIT_FAILURE);
                 }
-            }
-
-        }
-        // otherwise go as normal
-        else {
-            size_t toRead = sizeof(buffer);
-            if (bytesToTransfer - bytesSent < toRead) {
-                toRead = bytesToTransfer - bytesSent;
-            }
-            size_t read = fread(buffer, 1, toRead, file); // need to make sure that we don't reach end of file
-            struct packet* send_pkt = malloc(sizeof(struct packet));
-            if(send_pkt == NULL){
-                perror("malloc failed");
-            }
-            
-            send_pkt->seq_num = pack_num;
-            send_pkt->acked = 0;
-            pack_num++;
-            memcpy(&send_pkt->data,buffer,sizeof(buffer));
-            send_pkt->data_len = read;
-            if (send_packet(*send_pkt,sockfd,receiver_addr,BUFFER_SIZE) == 0) {
-                free(send_pkt);
                 break;
-            }   
-
-            // update global sequence number and window
-            CWND[num_CWND_occupied] = send_pkt;
-            num_CWND_occupied++;
-
-            // advance read pointer
-            bytesSent += read;
+            case 'p':
+                config.pacing_mode = PACING_CWND;
+                break;
+            case 'P':
+                config.pacing_rate = strtoull(optarg, NULL, 10);
+                config.pacing_mode = config.pacing_rate > 0 ? PACING_FIXED : PACING_OFF;
+                break;
+            case 'w':
+                config.window_capacity = atoi(optarg);
+                if (config.window_capacity < 1 || config.window_capacity > MAX_WINDOW_LIMIT) {
+                    fprintf(stderr, "window must be between 1 and %d packets\n", MAX_WINDOW_LIMIT);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'm':
+                config.max_payload = atoi(optarg);
+                if (config.max_payload < DATA_SIZE || config.max_payload > MAX_DATA_SIZE) {
+                    fprintf(stderr, "payload must be between %d and %d bytes\n", DATA_SIZE, MAX_DATA_SIZE);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'n':
+                streams = atoi(optarg);
+                if (streams < 1 || streams > MAX_STREAMS) {
+                    fprintf(stderr, "streams must be between 1 and %d\n", MAX_STREAMS);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'B':
+                config.batch_size = atoi(optarg);
+                if (config.batch_size < 1 || config.batch_size > MAX_BATCH_SIZE) {
+                    fprintf(stderr, "batch size must be between 1 and %d datagrams\n", MAX_BATCH_SIZE);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'G':
+                config.use_gso = 1;
+                break;
+            case 'F':
+                config.fec_k = atoi(optarg);
+                if (config.fec_k < 0 || config.fec_k > FEC_MAX_K) {
+                    fprintf(stderr, "parity block must be between 0 and %d packets\n", FEC_MAX_K);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'z':
+                config.compress = 1;
+                break;
+            case 'v':
+                print_stats = 1;
+                break;
+            case 'T':
+                if (telemetry_open(&telemetry, optarg, TELEMETRY_INTERVAL_US) == 0) {
+                    exit(EXIT_FAILURE);
+                }
+                config.telemetry = &telemetry;
+                atexit(close_telemetry);
+                break;
+            default:
+                usage(argv[0]);
         }
-    
     }
-    // specify reason to transmission end
-    if (bytesSent < bytesToTransfer) {
-        struct packet FIN; 
-        FIN.seq_num = -2;
-        FIN.acked = 0;
-        send_packet(FIN, sockfd, receiver_addr, packet_size);
+    if (argc - optind != 4) {
+        usage(argv[0]);
     }
-    fclose(file);
-    close(sockfd);
-}
 
+    char* hostname = argv[optind];
+    unsigned short int hostUDPport = (unsigned short int)atoi(argv[optind + 1]);
+    char* filename = argv[optind + 2];
+    unsigned long long int bytesToTransfer = strtoull(argv[optind + 3], NULL, 10);
 
-int main(int argc, char** argv) {
-    if (argc != 5) {
-        fprintf(stderr, "usage: %s receiver_hostname receiver_port filename_to_xfer bytes_to_xfer\n", argv[0]);
-        exit(EXIT_FAILURE);
+    if (streams > 1) {
+        return rsend_parallel(hostname, hostUDPport, filename, bytesToTransfer, streams) ? EXIT_SUCCESS : EXIT_FAILURE;
     }
-
-    char* hostname = argv[1];
-    unsigned short int hostUDPport = (unsigned short int)atoi(argv[2]);
-    char* filename = argv[3];
-    unsigned long long int bytesToTransfer = atoll(argv[4]);
-
-    rsend(hostname, hostUDPport, filename, bytesToTransfer);
-
-    return EXIT_SUCCESS;
+    return rsend(hostname, hostUDPport, filename, bytesToTransfer) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,753 @@
+/*
+@file session.c
+@brief the receiving end of one transfer, kept apart so one socket can serve many
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "protocol.h"
+#include "session.h"
+
+/*
+@brief how many slots of a size fit the memory cap
+
+@param config: the receiver's settings
+@param reserved: bytes of the cap already spoken for
+@param wanted: the most slots asked for
+@param slot_size: the bytes per slot
+
+@return a power of two no larger than wanted that fits the cap, at least 1,
+or wanted itself with no cap
+*/
+static int slots_within_cap(const struct session_config *config, size_t reserved, int wanted, size_t slot_size){
+    if(config->memory_cap == 0) return wanted;
+    size_t fits = config->memory_cap > reserved ? (config->memory_cap - reserved) / slot_size : 0;
+    int rounded = 1;
+    while((size_t)rounded * 2 <= fits && rounded < wanted) rounded <<= 1;
+    return rounded < wanted ? rounded : wanted;
+}
+
+/*
+@brief how many packets past the cumulative ack the sink can take
+
+@param s: the session
+@param payload: the largest payload
+
+@return the write queue's capacity for a file, the reorder buffer's for an in order sink
+*/
+static int sink_capacity(const struct session *s, int payload){
+    size_t reserved = s->fec_k > 0 ? (size_t)FEC_BLOCKS * payload : 0;
+    if(s->compressed){
+        // a compressed file needs both, a reorder slot and a write slot per packet
+        size_t slot_size = sizeof(struct packet_header) + payload;
+        if(s->positional && s->sink.kind == RDT_FD) slot_size += file_writer_slot_size(payload);
+        reserved += sizeof(struct block_header) + 2 * COMPRESS_BLOCK;
+        return slots_within_cap(s->config, reserved, s->config->reorder_size, slot_size);
+    }
+    if(s->ordered){
+        return slots_within_cap(s->config, reserved, s->config->reorder_size, sizeof(struct packet_header) + payload);
+    }
+    if(s->sink.kind == RDT_MEMORY) return s->config->reorder_size;
+    return slots_within_cap(s->config, reserved, s->config->write_queue_size, file_writer_slot_size(payload));
+}
+
+/*
+@brief the receive window to advertise
+
+packets past a gap are already buffered, every other packet in the
+window needs a free slot in the write queue, so a slow disk closes
+the window instead of stalling the receive loop
+
+@param s: the session
+
+@return how many sequence numbers past the cumulative ack may be sent
+*/
+static int receive_window(struct session *s){
+    // before the handshake picks a payload size the writer isn't running, its whole queue is free
+    int space = s->writer.slots != NULL ? file_writer_space(&s->writer) : s->queue_size;
+    int window = space + s->rwnd.count;
+    return window < s->rwnd.capacity ? window : s->rwnd.capacity;
+}
+
+/*
+@brief queues the SYN-ACK: the connection ID, the initial receive window, the ceiling, the parity block size and compression
+
+acked names the SYN it answers, so the sender can time that one even
+after resending it
+
+@param s: the session
+@param attempt: the answered SYN's acked, -1 for a resend on our own timer
+*/
+static void send_syn_ack(struct session *s, int attempt){
+    struct packet SYN_ACK;
+    memset(&SYN_ACK, 0, sizeof(SYN_ACK));
+    SYN_ACK.seq_num = -1;
+    SYN_ACK.conn_id = s->info.conn_id;
+    snprintf(SYN_ACK.data, sizeof(SYN_ACK.data), "%d %d %d %d %llu", receive_window(s), s->ceiling, s->fec_k, s->compressed,
+             s->info.resumed);
+    SYN_ACK.acked = attempt;
+    SYN_ACK.crc = crc32c_control(&SYN_ACK, sizeof(SYN_ACK));
+    if(batch_io_queue(s->batch, &SYN_ACK, sizeof(SYN_ACK), &s->info.peer, 1) == 0){
+        perror("failure to send receive window");
+    }
+    s->resend_at_us = monotonic_us() + rtt_rto(&s->rtt);
+}
+
+/*
+@brief what a file or memory sink keeps of a packet past a gap, for the digest once the gap is filled
+*/
+struct digest_piece {
+    uint32_t crc;
+    int len;
+};
+
+/*
+@brief adds the next in order packet to the digest of the data
+
+@param s: the session
+@param crc: the CRC32C of its payload
+@param len: the payload's length
+*/
+static void add_to_digest(struct session *s, uint32_t crc, int len){
+    if(len == s->payload_size){
+        s->info.digest = crc32c_shift_combine(&s->shift, s->info.digest, crc);
+    } else {
+        s->info.digest = crc32c_combine(s->info.digest, crc, len);
+    }
+}
+
+/*
+@brief answers a path MTU probe
+
+only a probe that arrived whole and that we'd accept as a payload is
+echoed, and only its header goes back
+
+@param s: the session
+@param hdr: the probe's header
+@param len: the number of bytes received for it
+*/
+static void echo_probe(struct session *s, const struct packet_header *hdr, size_t len){
+    if(hdr->data_len < 0 || hdr->data_len > s->ceiling || (size_t)hdr->data_len != len - sizeof(*hdr)) return;
+    struct packet_header echo = *hdr;
+    echo.crc = crc32c_control(&echo, sizeof(echo));
+    if(batch_io_queue(s->batch, &echo, sizeof(echo), &s->info.peer, 1) == 0){
+        perror("failed to echo probe");
+    }
+}
+
+/*
+@brief puts a packet's data at its offset in a file or memory sink
+
+A file gets it through the writer thread. The data goes straight to
+its final offset, so packets past a gap are written as they arrive
+instead of being buffered until it is filled
+
+@param s: the session
+@param seq: the packet's full sequence number
+@param hdr: the packet's header
+@param payload: its data_len bytes of data
+
+@return 0 if the sink can't take it, 1 otherwise
+*/
+static int write_packet(struct session *s, long long seq, const struct packet_header *hdr, const char *payload){
+    uint64_t offset = s->info.offset + (uint64_t)seq * s->payload_size;
+    if(s->sink.kind == RDT_MEMORY){
+        if(offset > s->sink.len || s->sink.len - offset < (size_t)hdr->data_len) return 0;
+        memcpy(s->sink.data + offset, payload, hdr->data_len);
+        return 1;
+    }
+    struct write_request *req = file_writer_reserve(&s->writer);
+    req->offset = offset;
+    req->len = hdr->data_len;
+    memcpy(req->data, payload, hdr->data_len);
+    file_writer_commit(&s->writer);
+    return 1;
+}
+
+/*
+@brief hands the next in order data to an in order sink
+
+@param s: the session
+@param payload: the data
+@param len: its length
+
+@return 0 if the sink refused it, 1 otherwise
+*/
+static int deliver(struct session *s, const char *payload, size_t len){
+    if(s->sink.kind == RDT_CALLBACK) return s->sink.write(s->sink.arg, payload, len);
+    while(len > 0){
+        ssize_t n = write(s->sink.fd, payload, len);
+        if(n < 0){
+            if(errno == EINTR) continue;
+            perror("Failed to write to the sink");
+            return 0;
+        }
+        payload += n;
+        len -= n;
+    }
+    return 1;
+}
+
+/*
+@brief puts a decompressed block where it goes, the next raw bytes of the transfer
+
+A file gets it through the writer thread a payload at a time, memory
+at its offset, and a pipe or callback in order.
+
+@param ctx: the session
+@param raw: the block's data
+@param len: its length
+
+@return 0 if the sink can't take it, 1 otherwise
+*/
+static int write_block(void *ctx, const char *raw, size_t len){
+    struct session *s = ctx;
+    uint64_t offset = s->info.offset + s->info.bytes_received;
+    if(s->info.bytes_received + len > s->info.bytes_expected) return 0;
+    s->info.bytes_received += len;
+    s->info.digest = crc32c(s->info.digest, raw, len);
+    if(!s->positional) return deliver(s, raw, len);
+    if(s->sink.kind == RDT_MEMORY){
+        if(offset > s->sink.len || s->sink.len - offset < len) return 0;
+        memcpy(s->sink.data + offset, raw, len);
+        return 1;
+    }
+    while(len > 0){
+        size_t chunk = len < (size_t)s->payload_size ? len : (size_t)s->payload_size;
+        struct write_request *req = file_writer_reserve(&s->writer);
+        req->offset = offset;
+        req->len = chunk;
+        memcpy(req->data, raw, chunk);
+        file_writer_commit(&s->writer);
+        offset += chunk;
+        raw += chunk;
+        len -= chunk;
+    }
+    return 1;
+}
+
+/*
+@brief hands the next in order data over, expanding it first if it is compressed
+
+@param s: the session
+@param payload: the data
+@param len: its length
+
+@return 0 if the sink refused it or a block is corrupt, 1 otherwise
+*/
+static int take_in_order(struct session *s, const char *payload, size_t len){
+    if(!s->compressed){
+        s->info.bytes_received += len;
+        return deliver(s, payload, len);
+    }
+    if(decompressor_feed(&s->decompressor, payload, len, write_block, s) == 0){
+        fprintf(stderr, "a compressed block did not expand to what it said\n");
+        return 0;
+    }
+    return 1;
+}
+
+/*
+@brief the end in the file of the data received in order, all of it already queued for the writer
+
+@param s: the session, with a file sink
+
+@return the offset just past it
+*/
+static uint64_t in_order_end(const struct session *s){
+    if(s->ordered) return s->info.offset + s->info.bytes_received;
+    uint64_t bytes = (uint64_t)s->rwnd.base * s->payload_size;
+    return s->info.offset + (bytes < s->info.bytes_expected ? bytes : s->info.bytes_expected);
+}
+
+/*
+@brief puts the file on disk and then records that the session's range up to end is there
+
+@param s: the session
+@param end: the end of the data written in order
+*/
+static void record_on_disk(struct session *s, uint64_t end){
+    if(fdatasync(s->sink.fd) < 0){
+        perror("Failed to sync the file");
+        return;
+    }
+    resume_record(&s->journal, end);
+}
+
+/*
+@brief the writer's on_mark: the data up to mark is written, put it in the journal if it is time
+
+@param arg: the session
+@param mark: the end of the data written in order
+*/
+static void record_written(void *arg, uint64_t mark){
+    struct session *s = arg;
+    uint64_t now = monotonic_us();
+    if(now < s->sync_due_us) return;
+    s->sync_due_us = now + RESUME_INTERVAL_US;
+    record_on_disk(s, mark);
+}
+
+/*
+@brief counts a packet towards the next delayed ack
+
+@param s: the session
+
+@return 1 if the ack is due now, 0 if it waits for more packets or its deadline
+*/
+static int hold_ack(struct session *s){
+    s->unacked_packets++;
+    if(s->unacked_packets >= s->config->ack_every) return 1;
+    if(s->unacked_packets == 1){
+        s->ack_deadline_us = s->last_heard_us + s->config->ack_delay_us;
+    }
+    return 0;
+}
+
+/*
+@brief takes a data packet that arrived or was rebuilt from parity
+
+@param s: the session
+@param seq: its full sequence number
+@param hdr: its header, with crc the CRC32C of the payload alone
+@param payload: its hdr->data_len bytes
+@param recovered: 1 if it was rebuilt, so it isn't counted as a duplicate
+
+@return the same as session_handle()
+*/
+static int handle_data(struct session *s, long long seq, const struct packet_header *hdr, const char *payload, int recovered){
+    // if packet already received, the sender missed our ack: resend it now
+    if(seq < s->rwnd.base || reorder_buffer_contains(&s->rwnd, seq)){
+        if(!recovered) s->info.duplicates++;
+        return 1;
+    }
+    // packets past a gap are written right away, only their arrival is
+    // remembered, and the gap is reported right away. An in order sink
+    // keeps the packet in the buffer until the gap is filled
+    if(seq != s->rwnd.base){
+        // past the buffer's reach: drop without an ack so the sender resends it
+        struct digest_piece piece;
+        piece.crc = hdr->crc;
+        piece.len = hdr->data_len;
+        if(reorder_buffer_insert(&s->rwnd, seq, s->ordered ? NULL : &piece) < 0) return 0;
+        s->info.out_of_order++;
+        if(s->rwnd.count > s->info.reorder_peak) s->info.reorder_peak = s->rwnd.count;
+        if(s->ordered){
+            char *slot = reorder_buffer_get(&s->rwnd, seq);
+            memcpy(slot, hdr, sizeof(*hdr));
+            memcpy(slot + sizeof(*hdr), payload, hdr->data_len);
+        } else if(write_packet(s, seq, hdr, payload) == 0){
+            s->failed = 1;
+            return -1;
+        }
+        // an in order sink counts the bytes once they are handed over
+        if(!s->ordered) s->info.bytes_received += hdr->data_len;
+        // a loss the block's parity may still fix isn't worth a resend yet
+        if(s->fec_k > 0 && seq / s->fec_k == s->rwnd.base / s->fec_k && !fec_decoder_has_parity(&s->fec, seq)){
+            return hold_ack(s);
+        }
+        return 1;
+    }
+
+    int taken = s->ordered ? take_in_order(s, payload, hdr->data_len) : write_packet(s, seq, hdr, payload);
+    if(taken == 0){
+        s->failed = 1;
+        return -1;
+    }
+    if(!s->ordered) s->info.bytes_received += hdr->data_len;
+    if(!s->compressed) add_to_digest(s, hdr->crc, hdr->data_len);
+    reorder_buffer_advance(&s->rwnd);
+
+    // the packets up to the next gap are already written, just move past
+    // them, or hand them over now that they are in order
+    int ready = reorder_buffer_ready(&s->rwnd);
+    for(int i = 0; i < ready; i++){
+        if(s->ordered){
+            const char *slot = reorder_buffer_front(&s->rwnd);
+            struct packet_header buffered;
+            memcpy(&buffered, slot, sizeof(buffered));
+            if(take_in_order(s, slot + sizeof(buffered), buffered.data_len) == 0){
+                s->failed = 1;
+                return -1;
+            }
+            if(!s->compressed) add_to_digest(s, buffered.crc, buffered.data_len);
+        } else {
+            struct digest_piece piece;
+            memcpy(&piece, reorder_buffer_front(&s->rwnd), sizeof(piece));
+            add_to_digest(s, piece.crc, piece.len);
+        }
+        reorder_buffer_advance(&s->rwnd);
+    }
+    // marks along the queue let the writer record its progress, however far behind it is
+    if(s->journal.path != NULL && in_order_end(s) >= s->next_mark){
+        file_writer_mark(&s->writer, in_order_end(s));
+        s->next_mark = in_order_end(s) + RESUME_MARK_BYTES;
+    }
+
+    if(s->info.bytes_received >= s->info.bytes_expected){
+        // all here, stay around to ack whatever the sender resends because an ack got lost
+        s->state = SESSION_DONE;
+        s->info.finished_us = s->last_heard_us;
+        s->linger_until_us = s->info.finished_us + SESSION_LINGER_US;
+        return 1;
+    }
+
+    // coalesce acks for in order data, but ack at once when a gap was
+    // filled or packets are still buffered behind one
+    if(ready > 0 || s->rwnd.highest >= s->rwnd.base){
+        return 1;
+    }
+    return hold_ack(s);
+}
+
+/*
+@brief rebuilds a block's lost packet and takes it as if it arrived
+
+@param s: the session
+@param slot: the block's slot in the decoder
+
+@return the same as session_handle()
+*/
+static int recover(struct session *s, int slot){
+    struct packet_header hdr;
+    long long seq;
+    int len;
+    const char *payload = fec_decoder_recover(&s->fec, slot, &seq, &len);
+    if(payload == NULL) return 0;
+    hdr.seq_num = seq_wire(seq);
+    hdr.data_len = len;
+    hdr.conn_id = s->info.conn_id;
+    hdr.crc = crc32c(0, payload, len);
+    s->info.fec_recovered++;
+    return handle_data(s, seq, &hdr, payload, 1);
+}
+
+/*
+@brief notes a datagram that checked out: the session isn't idle and replies go where it came from
+
+@param s: the session
+@param from: the sender's address
+*/
+static void heard_from(struct session *s, const struct sockaddr_in *from){
+    s->last_heard_us = monotonic_us();
+    s->info.peer = *from;
+}
+
+/*
+@brief takes a parity packet and rebuilds the one packet of its block that was lost
+
+@param s: the session
+@param data: the datagram
+@param len: its length
+@param from: the sender's address
+
+@return the same as session_handle()
+*/
+static int handle_parity(struct session *s, const char *data, size_t len, const struct sockaddr_in *from){
+    struct packet_header hdr;
+    struct fec_header fec;
+    if(s->state != SESSION_OPEN || s->fec_k == 0 || len < sizeof(hdr) + sizeof(fec)) return 0;
+    memcpy(&hdr, data, sizeof(hdr));
+    memcpy(&fec, data + sizeof(hdr), sizeof(fec));
+    if(hdr.data_len < 0 || (size_t)hdr.data_len != len - sizeof(hdr) - sizeof(fec)) return 0;
+    if(crc32c_packet(&hdr, crc32c(0, data + sizeof(hdr), len - sizeof(hdr))) != hdr.crc){
+        s->info.corrupt++;
+        return 0;
+    }
+    heard_from(s, from);
+
+    long long first = seq_unwrap(fec.first_seq, s->rwnd.base);
+    int slot = fec_decoder_add_parity(&s->fec, first, fec.count, fec.len_xor, data + sizeof(hdr) + sizeof(fec), hdr.data_len);
+    if(slot < 0){
+        // nothing to rebuild: if a gap of this block was waiting on it, report the gap now
+        return first / s->fec_k == s->rwnd.base / s->fec_k && s->rwnd.highest >= s->rwnd.base;
+    }
+    return recover(s, slot);
+}
+
+/*
+@brief gets the sink ready for the payload size, from the sender's handshake ack or the SYN
+
+a file starts its writer, an in order sink gets a reorder buffer
+that keeps the packets waiting behind a gap
+
+@param s: the session
+@param payload: the payload size the sender asked for
+
+@return 0 in case of failure, 1 in case of success
+*/
+static int open_session(struct session *s, int payload){
+    s->payload_size = payload >= DATA_SIZE && payload <= s->ceiling ? payload : DATA_SIZE;
+    s->queue_size = sink_capacity(s, s->payload_size);
+    if(s->ordered){
+        reorder_buffer_free(&s->rwnd);
+        if(reorder_buffer_init(&s->rwnd, s->queue_size, sizeof(struct packet_header) + s->payload_size, 0) == 0){
+            return 0;
+        }
+    }
+    if(s->positional && s->sink.kind == RDT_FD &&
+       file_writer_start(&s->writer, s->sink.fd, s->queue_size, s->config->write_rate, s->payload_size) == 0){
+        return 0;
+    }
+    if(s->journal.path != NULL){
+        s->writer.on_mark = record_written;
+        s->writer.mark_arg = s;
+        s->sync_due_us = monotonic_us() + RESUME_INTERVAL_US;
+        s->next_mark = s->info.offset + RESUME_MARK_BYTES;
+    }
+    if(s->compressed && decompressor_init(&s->decompressor) == 0){
+        return 0;
+    }
+    crc32c_shift_init(&s->shift, s->payload_size);
+    if(s->fec_k > 0 && fec_decoder_init(&s->fec, s->fec_k, s->payload_size, FEC_BLOCKS) == 0){
+        return 0;
+    }
+    s->state = SESSION_OPEN;
+    if(s->info.bytes_expected == 0){
+        s->state = SESSION_DONE;
+        s->info.finished_us = monotonic_us();
+        s->linger_until_us = s->info.finished_us + SESSION_LINGER_US;
+    }
+    return 1;
+}
+
+int session_parse_syn(const char *data, size_t len, struct syn_request *syn){
+    struct packet SYN;
+    if(len <= sizeof(struct ack_packet)) return 0;
+    memset(&SYN, 0, sizeof(SYN));
+    memcpy(&SYN, data, len < sizeof(SYN) ? len : sizeof(SYN));
+    if(SYN.seq_num != -1 || crc32c_control(data, len) != SYN.crc) return 0;
+    SYN.data[DATA_SIZE - 1] = '\0';
+
+    memset(syn, 0, sizeof(*syn));
+    syn->attempt = len >= sizeof(SYN) ? SYN.acked : -1;
+    syn->total = 1;
+    syn->payload = DATA_SIZE;
+    int name_at = -1;
+    sscanf(SYN.data, "%llu %d %llu %llu %d %d %lld %n", &syn->total, &syn->payload, &syn->offset, &syn->file_length, &syn->fec_k,
+           &syn->compress, &syn->mtime, &name_at);
+    if(name_at >= 0) snprintf(syn->name, sizeof(syn->name), "%s", SYN.data + name_at);
+    return 1;
+}
+
+int session_init(struct session *s, const struct session_config *config, struct batch_io *batch, int conn_id,
+                 const struct sockaddr_in *peer, const struct rdt_sink *sink, const struct syn_request *syn){
+    memset(s, 0, sizeof(*s));
+    s->info.conn_id = conn_id;
+    s->info.peer = *peer;
+    snprintf(s->info.name, sizeof(s->info.name), "%s", syn->name);
+    s->info.offset = syn->offset;
+    s->info.file_length = syn->file_length;
+    s->info.mtime = syn->mtime;
+    s->info.bytes_expected = syn->total;
+    s->info.digest_match = -1;
+    s->state = SESSION_HANDSHAKE;
+    s->config = config;
+    s->batch = batch;
+    s->sink = *sink;
+    // pipes and sockets can't take a write at an offset, compressed blocks only expand in order
+    s->positional = sink->kind == RDT_MEMORY || (sink->kind == RDT_FD && lseek(sink->fd, 0, SEEK_CUR) >= 0);
+    s->compressed = syn->compress == 1;
+    s->ordered = !s->positional || s->compressed;
+    // what an earlier try of the same file left on disk isn't sent again
+    if(s->positional && sink->kind == RDT_FD && sink->journal != NULL){
+        s->info.resumed = resume_begin(&s->journal, sink->journal, sink->fd, syn->file_length, syn->mtime, syn->offset,
+                                       syn->total);
+        s->info.offset += s->info.resumed;
+        s->info.bytes_expected -= s->info.resumed;
+    }
+    s->ceiling = syn->payload < config->max_payload ? syn->payload : config->max_payload;
+    if(s->ceiling < DATA_SIZE) s->ceiling = DATA_SIZE;
+    s->payload_size = DATA_SIZE;
+    s->fec_k = syn->fec_k >= 1 && syn->fec_k <= FEC_MAX_K ? syn->fec_k : 0;
+    // the window offered before the payload size is known has to fit the largest one
+    s->queue_size = sink_capacity(s, s->ceiling);
+
+    // the data is written as it arrives, the buffer only tracks which packets did and their CRCs
+    if(reorder_buffer_init(&s->rwnd, config->reorder_size, sizeof(struct digest_piece), 0) == 0){
+        return 0;
+    }
+    // the SYN-ACK is resent on a backed off timeout, starting like the sender's
+    rtt_init(&s->rtt, RTO_HANDSHAKE_US);
+    s->info.started_us = monotonic_us();
+    s->last_heard_us = s->info.started_us;
+    // with DATA_SIZE the only payload left there's no handshake ack to wait for, data may follow the SYN
+    if(s->ceiling == DATA_SIZE && open_session(s, DATA_SIZE) == 0){
+        session_close(s);
+        return 0;
+    }
+    send_syn_ack(s, syn->attempt);
+    return 1;
+}
+
+void session_send_ack(struct session *s){
+    struct ack_packet ack;
+    long long starts[MAX_SACK_BLOCKS], ends[MAX_SACK_BLOCKS];
+    ack.seq_num = seq_wire(s->rwnd.base);
+    ack.window = receive_window(s);
+    ack.conn_id = s->info.conn_id;
+    ack.num_sacks = reorder_buffer_runs(&s->rwnd, starts, ends, MAX_SACK_BLOCKS);
+    for(int i = 0; i < ack.num_sacks; i++){
+        ack.sacks[i].start = seq_wire(starts[i]);
+        ack.sacks[i].end = seq_wire(ends[i]);
+    }
+    size_t len = offsetof(struct ack_packet, sacks) + ack.num_sacks * sizeof(struct sack_block);
+    ack.crc = crc32c_control(&ack, len);
+
+    s->unacked_packets = 0;
+    if(batch_io_queue(s->batch, &ack, len, &s->info.peer, 1) == 0){
+        perror("failed to send ack ");
+    }
+}
+
+int session_handle(struct session *s, const char *data, size_t len, const struct sockaddr_in *from){
+    struct packet_header hdr;
+    if(len < sizeof(hdr)) return 0;
+    memcpy(&hdr, data, sizeof(hdr));
+    // data and parity packets are checked with their payload below
+    if(hdr.seq_num < 0 && hdr.seq_num != -5){
+        if(crc32c_control(data, len) != hdr.crc){
+            s->info.corrupt++;
+            return 0;
+        }
+        heard_from(s, from);
+    }
+
+    if(hdr.seq_num == -2){
+        return -1;
+    }
+    if(hdr.seq_num == -3){
+        // the sender is probing a closed window, tell it where the window is now
+        return s->state != SESSION_HANDSHAKE;
+    }
+    if(hdr.seq_num == -4){
+        // its echo is proof the size gets through, also for a late probe
+        echo_probe(s, &hdr, len);
+        return 0;
+    }
+    if(hdr.seq_num == -1){
+        if(len > sizeof(struct ack_packet)){
+            // the sender resent its SYN, so our SYN-ACK was lost or is late: answer right away,
+            // a session the SYN opened may be taking data without it
+            struct syn_request syn;
+            if(session_parse_syn(data, len, &syn)) send_syn_ack(s, syn.attempt);
+            return 0;
+        }
+        if(s->state != SESSION_HANDSHAKE || len < sizeof(struct ack_packet)) return 0;     // a late copy of the handshake ack
+        struct ack_packet ack;
+        memcpy(&ack, data, sizeof(ack));
+        if(open_session(s, ack.window) == 0) return -1;
+        return s->state == SESSION_DONE;     // nothing to send, the ack says it's all here
+    }
+
+    if(hdr.seq_num == -5){
+        return handle_parity(s, data, len, from);
+    }
+    if(hdr.seq_num == -6){
+        // the sender's digest of the data, it resends it until we answer with ours
+        uint32_t digest;
+        if(s->state == SESSION_HANDSHAKE || hdr.data_len != sizeof(digest) || len != sizeof(hdr) + sizeof(digest)) return 0;
+        memcpy(&digest, data + sizeof(hdr), sizeof(digest));
+        s->info.digest_match = s->state == SESSION_DONE && digest == s->info.digest;
+        struct packet reply;
+        memcpy(&reply, &hdr, sizeof(hdr));
+        memcpy(reply.data, &s->info.digest, sizeof(digest));
+        reply.crc = crc32c_control(&reply, len);
+        if(batch_io_queue(s->batch, &reply, len, &s->info.peer, 1) == 0){
+            perror("failed to answer the digest");
+        }
+        // the sender saw every packet acked that we are still waiting for, nothing more will come
+        if(s->state != SESSION_DONE) return -1;
+        return 1;
+    }
+
+    // a data packet is its header and exactly data_len bytes, drop anything else. Data
+    // before the handshake ack means that ack was lost, the next SYN-ACK asks for it again
+    if(s->state == SESSION_HANDSHAKE || hdr.seq_num < 0 || hdr.data_len < 0 || hdr.data_len > s->payload_size ||
+       (size_t)hdr.data_len != len - sizeof(hdr)){
+        return 0;
+    }
+    // a damaged packet is dropped like a lost one, the sender resends it
+    uint32_t payload_crc = crc32c(0, data + sizeof(hdr), hdr.data_len);
+    if(crc32c_packet(&hdr, payload_crc) != hdr.crc){
+        s->info.corrupt++;
+        return 0;
+    }
+    heard_from(s, from);
+    hdr.crc = payload_crc;
+    long long seq = seq_unwrap(hdr.seq_num, s->rwnd.base);
+    s->info.packets_received++;
+    int fresh = seq >= s->rwnd.base && !reorder_buffer_contains(&s->rwnd, seq);
+    int result = handle_data(s, seq, &hdr, data + sizeof(hdr), 0);
+    if(result < 0 || !fresh || s->fec_k == 0 || s->state != SESSION_OPEN) return result;
+
+    // count it towards its block, that may leave just one packet to rebuild
+    int slot = fec_decoder_add(&s->fec, seq, data + sizeof(hdr), hdr.data_len);
+    if(slot >= 0){
+        int rebuilt = recover(s, slot);
+        if(rebuilt != 0) result = rebuilt;
+    }
+    return result;
+}
+
+uint64_t session_deadline(const struct session *s){
+    if(s->state == SESSION_HANDSHAKE) return s->resend_at_us;
+    if(s->state == SESSION_DONE) return s->linger_until_us;
+    uint64_t idle = s->last_heard_us + SESSION_IDLE_US;
+    return s->unacked_packets > 0 && s->ack_deadline_us < idle ? s->ack_deadline_us : idle;
+}
+
+int session_timeout(struct session *s, uint64_t now){
+    if(s->state == SESSION_HANDSHAKE){
+        if(now < s->resend_at_us) return 0;
+        if(rtt_backoff(&s->rtt) > RTO_MAX_RETRIES) return -1;
+        send_syn_ack(s, -1);
+        return 0;
+    }
+    if(s->state == SESSION_DONE){
+        if(now < s->linger_until_us) return 0;
+        // closing waits for the writer, don't let it stall the other sessions
+        if(s->writer.slots != NULL && file_writer_space(&s->writer) < s->writer.capacity){
+            s->linger_until_us = now + SESSION_DRAIN_US;
+            return 0;
+        }
+        return -1;
+    }
+    if(s->unacked_packets > 0 && now >= s->ack_deadline_us){
+        session_send_ack(s);
+    }
+    return now >= s->last_heard_us + SESSION_IDLE_US ? -1 : 0;
+}
+
+int session_close(struct session *s){
+    int ok = s->info.bytes_received >= s->info.bytes_expected && !s->failed;
+    int written = s->writer.slots != NULL;
+    if(written && file_writer_finish(&s->writer) == 0){
+        fprintf(stderr, "some received data could not be written\n");
+        ok = 0;
+        written = 0;
+    }
+    reorder_buffer_free(&s->rwnd);
+    if(s->fec_k > 0) fec_decoder_free(&s->fec);
+    if(s->compressed) decompressor_free(&s->decompressor);
+    if(s->info.digest_match == 0){
+        fprintf(stderr, "the CRC32C of the received data doesn't match the sender's\n");
+        // none of it can be trusted for a resume
+        resume_discard(&s->journal);
+        return 0;
+    }
+    // a cut off transfer keeps what it got, a finished one clears the journal it left
+    if(written && s->journal.path != NULL && (!ok || s->journal.exists)){
+        record_on_disk(s, in_order_end(s));
+    }
+    return ok;
+}
@@ -0,0 +1,192 @@
+/*
+@file session.h
+@brief the receiving end of one transfer, kept apart so one socket can serve many
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+
+#include "batch_io.h"
+#include "compress.h"
+#include "crc32c.h"
+#include "endpoint.h"
+#include "fec.h"
+#include "file_writer.h"
+#include "reorder_buffer.h"
+#include "resume.h"
+#include "rtt.h"
+
+#define SESSION_IDLE_US RTO_MAX_US      // a live sender is heard from at least this often
+#define SESSION_LINGER_US 2000000ULL    // how long a finished session keeps acking resends
+#define SESSION_DRAIN_US 10000ULL       // how often a finished session checks its writer again
+
+/*
+@brief settings shared by every session of a receiver
+*/
+struct session_config {
+    int reorder_size;           // packets accepted past a gap
+    int ack_every;              // in order packets covered by one ack
+    uint64_t ack_delay_us;      // longest an in order packet waits for its ack
+    int write_queue_size;       // queued writes, before the memory cap
+    int max_payload;
+    uint64_t write_rate;        // bytes/s per session written to a file, 0 for no limit
+    size_t memory_cap;          // most bytes queued or reordered per session, 0 for no cap
+};
+
+/*
+@brief what a sender's SYN asks for, see struct packet
+*/
+struct syn_request {
+    unsigned long long total;
+    int payload;                // the sender's largest payload
+    unsigned long long offset;
+    unsigned long long file_length;
+    long long mtime;            // the file's modification time in nanoseconds, 0 if unknown
+    int fec_k;                  // data packets per parity packet, 0 for none
+    int compress;               // 1 if the sender offers compressed blocks
+    int attempt;                // which of the sender's SYNs this is, echoed in the SYN-ACK
+    char name[RDT_NAME_MAX];
+};
+
+enum session_state {
+    SESSION_HANDSHAKE,          // SYN-ACK sent, waiting for the payload size
+    SESSION_OPEN,               // receiving data
+    SESSION_DONE                // everything arrived, still acking the sender's resends
+};
+
+/*
+@brief one sender's transfer: its sink, reorder state, writer and timers
+
+Nothing here blocks on the network. The owner feeds it the datagrams
+carrying its connection ID, sends the acks it asks for and calls
+session_timeout() once session_deadline() passes, so any number of
+sessions can share one socket and one event loop. Acks and echoes are
+queued on the socket's batch, the owner flushes it.
+
+The write queue of a file sink, the reorder buffer of an in order
+sink, and the parity and compression blocks are the only per-session
+memory that grows with the payload size and they are sized to fit
+memory_cap. The receive window never offers
+more than it can take, so a session stays within the cap however many
+packets its sender has in flight.
+*/
+struct session {
+    struct rdt_transfer info;   // the ID, the peer and the totals
+    enum session_state state;
+    const struct session_config *config;
+    struct batch_io *batch;     // the socket's batch, the session only queues on it
+    struct rdt_sink sink;
+    int ordered;                // 1 if data is handed over only in order: the sink needs it, or it is compressed
+    int positional;             // 1 if the sink takes writes at an offset, a file or memory
+    int compressed;             // 1 if the packets carry compressed blocks
+    int failed;                 // 1 once the sink refused data
+    int ceiling;                // the largest payload both ends accept
+    int payload_size;           // negotiated in the handshake
+    int queue_size;             // write queue capacity within the memory cap
+    int fec_k;                  // data packets per parity packet, 0 for none
+    struct fec_decoder fec;
+    struct decompressor decompressor;
+    struct crc32c_shift shift;  // appends a full payload's CRC to the digest
+    struct reorder_buffer rwnd;
+    struct file_writer writer;
+    struct resume_journal journal;
+    uint64_t next_mark;         // the in order end at which the writer gets its next mark
+    uint64_t sync_due_us;       // the writer thread's: when a mark next goes in the journal
+    int unacked_packets;
+    uint64_t ack_deadline_us;
+    struct rtt_estimator rtt;   // backs off the SYN-ACK's resends
+    uint64_t resend_at_us;
+    uint64_t last_heard_us;
+    uint64_t linger_until_us;
+    uint64_t timer_us;          // owner's bookkeeping: the deadline armed for it, 0 if none
+    int ack_queued;             // owner's bookkeeping: listed for an ack after this batch
+    struct sockaddr_in syn_peer; // owner's bookkeeping: where the SYN came from, its peer hash key
+    struct session *peer_next;   // owner's bookkeeping: the next session in its peer hash bucket
+};
+
+/*
+@brief reads a SYN's request
+
+@param data: the SYN datagram
+@param len: its length
+@param syn: where to store the request, fields the SYN leaves out stay at their defaults
+
+@return 0 if it isn't a SYN, 1 otherwise
+*/
+int session_parse_syn(const char *data, size_t len, struct syn_request *syn);
+
+/*
+@brief sets up a session for a SYN and queues the SYN-ACK
+
+A SYN whose sender can't go past DATA_SIZE opens the session right
+away, so a small transfer's data can follow its SYN without waiting.
+
+@param s: the session to initialize
+@param config: the receiver's settings, must outlive the session
+@param batch: the batch of the socket the SYN came in on
+@param conn_id: the connection ID handed to the sender, not 0
+@param peer: the sender's address
+@param sink: where the data goes, it stays the caller's
+@param syn: the SYN's request
+
+@return 0 in case of failure, 1 in case of success
+*/
+int session_init(struct session *s, const struct session_config *config, struct batch_io *batch, int conn_id,
+                 const struct sockaddr_in *peer, const struct rdt_sink *sink, const struct syn_request *syn);
+
+/*
+@brief handles one datagram carrying the session's connection ID, or one its sender sent before it had the ID
+
+@param s: the session
+@param data: the datagram
+@param len: its length
+@param from: where it came from, later acks go there
+
+@return -1 if the session ended, 1 if an ack is due now, 0 otherwise
+*/
+int session_handle(struct session *s, const char *data, size_t len, const struct sockaddr_in *from);
+
+/*
+@brief queues an ack: cumulative, the receive window and the sack blocks
+
+@param s: the session
+*/
+void session_send_ack(struct session *s);
+
+/*
+@brief when the session next needs session_timeout()
+
+@param s: the session
+
+@return the deadline in monotonic microseconds
+*/
+uint64_t session_deadline(const struct session *s);
+
+/*
+@brief runs whatever is due: delayed acks, SYN-ACK resends, idle and linger timeouts
+
+@param s: the session
+@param now: the current monotonic time in microseconds
+
+@return -1 if the session is over, 0 otherwise
+*/
+int session_timeout(struct session *s, uint64_t now);
+
+/*
+@brief waits for the queued writes and releases everything but the sink
+
+@param s: the session
+
+@return 1 if every byte arrived and was written, 0 otherwise
+*/
+int session_close(struct session *s);
+
+#endif
@@ -0,0 +1,131 @@
+/*
+@file telemetry.c
+@brief latency histograms and periodic JSON-lines stats, for seeing why a transfer is slow
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include <errno.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "telemetry.h"
+
+#define TELEMETRY_LINE_MAX 1024
+
+/*
+@brief the bucket a value is counted in
+
+@param value: the value
+
+@return the bucket's index
+*/
+static int histogram_bucket(uint64_t value){
+    if(value < HISTOGRAM_SUB_BUCKETS) return value;
+    int msb = 63 - __builtin_clzll(value);
+    int bucket = (msb - 2) * HISTOGRAM_SUB_BUCKETS + ((value >> (msb - 3)) & (HISTOGRAM_SUB_BUCKETS - 1));
+    return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+/*
+@brief the middle of a bucket's range
+
+@param bucket: the bucket's index
+
+@return the value the bucket stands for
+*/
+static uint64_t histogram_value(int bucket){
+    if(bucket < HISTOGRAM_SUB_BUCKETS) return bucket;
+    int msb = bucket / HISTOGRAM_SUB_BUCKETS + 2;
+    uint64_t width = 1ULL << (msb - 3);
+    return (uint64_t)(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) * width + width / 2;
+}
+
+void histogram_init(struct histogram *h){
+    memset(h, 0, sizeof(*h));
+}
+
+void histogram_record(struct histogram *h, uint64_t value){
+    h->counts[histogram_bucket(value)]++;
+    h->total++;
+    if(value > h->max) h->max = value;
+}
+
+uint64_t histogram_percentile(const struct histogram *h, double percentile){
+    if(h->total == 0) return 0;
+    uint64_t rank = (uint64_t)(h->total * percentile / 100.0);
+    if(rank >= h->total) rank = h->total - 1;
+    uint64_t seen = 0;
+    for(int i = 0; i < HISTOGRAM_BUCKETS; i++){
+        seen += h->counts[i];
+        if(seen > rank){
+            uint64_t value = histogram_value(i);
+            return value < h->max ? value : h->max;
+        }
+    }
+    return h->max;
+}
+
+int telemetry_open(struct telemetry *t, const char *target, uint64_t interval_us){
+    memset(t, 0, sizeof(*t));
+    t->sockfd = -1;
+    t->interval_us = interval_us;
+    if(strncmp(target, "unix:", 5) == 0){
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if(strlen(target + 5) >= sizeof(addr.sun_path)){
+            fprintf(stderr, "telemetry socket path too long\n");
+            return 0;
+        }
+        strcpy(addr.sun_path, target + 5);
+        t->sockfd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if(t->sockfd < 0 || connect(t->sockfd, (const struct sockaddr *)&addr, sizeof(addr)) < 0){
+            perror("failed to connect the telemetry socket");
+            if(t->sockfd >= 0) close(t->sockfd);
+            t->sockfd = -1;
+            return 0;
+        }
+        return 1;
+    }
+    t->file = strcmp(target, "-") == 0 ? stderr : fopen(target, "a");
+    if(t->file == NULL){
+        perror("failed to open the telemetry file");
+        return 0;
+    }
+    // whole lines, so processes appending to one file don't interleave
+    setvbuf(t->file, NULL, _IOLBF, 0);
+    return 1;
+}
+
+void telemetry_emit(struct telemetry *t, const char *fmt, ...){
+    if(t == NULL) return;
+    char line[TELEMETRY_LINE_MAX];
+    line[0] = '{';
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line + 1, sizeof(line) - 3, fmt, args);
+    va_end(args);
+    if(len < 0) return;
+    if(len > (int)sizeof(line) - 4) len = sizeof(line) - 4;
+    line[len + 1] = '}';
+    line[len + 2] = '\n';
+    if(t->sockfd >= 0){
+        // a slow reader costs lines, never the transfer's time
+        if(send(t->sockfd, line, len + 3, MSG_DONTWAIT) < 0 && errno != EINTR) t->dropped++;
+    } else if(t->file != NULL){
+        fwrite(line, 1, len + 3, t->file);
+    }
+}
+
+void telemetry_close(struct telemetry *t){
+    if(t->file != NULL && t->file != stderr) fclose(t->file);
+    if(t->sockfd >= 0) close(t->sockfd);
+    t->file = NULL;
+    t->sockfd = -1;
+}
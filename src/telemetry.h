@@ -0,0 +1,94 @@
+/*
+@file telemetry.h
+@brief latency histograms and periodic JSON-lines stats, for seeing why a transfer is slow
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define TELEMETRY_INTERVAL_US 100000ULL     // default time between samples of a transfer
+#define HISTOGRAM_SUB_BUCKETS 8             // buckets per power of two, so a percentile is within 12.5%
+#define HISTOGRAM_BUCKETS (62 * HISTOGRAM_SUB_BUCKETS)
+
+/*
+@brief log-linear histogram of microsecond values
+
+Values below HISTOGRAM_SUB_BUCKETS are counted exactly, larger ones in
+HISTOGRAM_SUB_BUCKETS buckets per power of two. Recording is a few
+shifts and an increment, cheap enough for every ack.
+*/
+struct histogram {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+};
+
+/*
+@brief where samples go: a JSON-lines file or a Unix datagram socket
+*/
+struct telemetry {
+    FILE *file;
+    int sockfd;
+    uint64_t interval_us;
+    unsigned long long dropped;     // lines a full socket didn't take
+};
+
+/*
+@brief empties a histogram
+
+@param h: the histogram
+*/
+void histogram_init(struct histogram *h);
+
+/*
+@brief counts one value
+
+@param h: the histogram
+@param value: the value, e.g. an RTT in microseconds
+*/
+void histogram_record(struct histogram *h, uint64_t value);
+
+/*
+@brief the value below which a share of the counted values fall
+
+@param h: the histogram
+@param percentile: the share, 0 to 100
+
+@return the middle of the percentile's bucket, 0 if nothing was counted
+*/
+uint64_t histogram_percentile(const struct histogram *h, double percentile);
+
+/*
+@brief opens where samples go
+
+@param t: the telemetry to initialize
+@param target: unix:path for a Unix datagram socket, - for stderr, otherwise a file appended to
+@param interval_us: time between samples of a transfer
+
+@return 0 in case of failure, 1 in case of success
+*/
+int telemetry_open(struct telemetry *t, const char *target, uint64_t interval_us);
+
+/*
+@brief writes one JSON object as a line, never blocking on a socket
+
+@param t: the telemetry, may be NULL
+@param fmt: printf format of the object's fields, without the braces
+*/
+void telemetry_emit(struct telemetry *t, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/*
+@brief closes the file or the socket
+
+@param t: the telemetry
+*/
+void telemetry_close(struct telemetry *t);
+
+#endif
@@ -0,0 +1,81 @@
+/*
+@file timer_heap.c
+@brief binary min-heap of deadlines, used for per-packet retransmission timers
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "timer_heap.h"
+
+int timer_heap_init(struct timer_heap *heap, int cap){
+    if(cap < 1) cap = 1;
+    heap->entries = malloc(sizeof(struct timer_entry) * cap);
+    if(heap->entries == NULL){
+        perror("timer heap malloc failed");
+        return 0;
+    }
+    heap->len = 0;
+    heap->cap = cap;
+    return 1;
+}
+
+void timer_heap_free(struct timer_heap *heap){
+    free(heap->entries);
+    heap->entries = NULL;
+    heap->len = 0;
+    heap->cap = 0;
+}
+
+int timer_heap_push(struct timer_heap *heap, uint64_t deadline_us, long long key){
+    if(heap->len == heap->cap){
+        struct timer_entry *grown = realloc(heap->entries, sizeof(struct timer_entry) * heap->cap * 2);
+        if(grown == NULL){
+            perror("timer heap realloc failed");
+            return 0;
+        }
+        heap->entries = grown;
+        heap->cap *= 2;
+    }
+
+    // sift up
+    int i = heap->len++;
+    while(i > 0){
+        int parent = (i - 1) / 2;
+        if(heap->entries[parent].deadline_us <= deadline_us) break;
+        heap->entries[i] = heap->entries[parent];
+        i = parent;
+    }
+    heap->entries[i].deadline_us = deadline_us;
+    heap->entries[i].key = key;
+    return 1;
+}
+
+int timer_heap_peek(const struct timer_heap *heap, struct timer_entry *out){
+    if(heap->len == 0) return 0;
+    *out = heap->entries[0];
+    return 1;
+}
+
+int timer_heap_pop(struct timer_heap *heap, struct timer_entry *out){
+    if(heap->len == 0) return 0;
+    if(out != NULL) *out = heap->entries[0];
+
+    // sift the last entry down from the root
+    struct timer_entry last = heap->entries[--heap->len];
+    int i = 0;
+    while(1){
+        int child = 2 * i + 1;
+        if(child >= heap->len) break;
+        if(child + 1 < heap->len && heap->entries[child + 1].deadline_us < heap->entries[child].deadline_us) child++;
+        if(last.deadline_us <= heap->entries[child].deadline_us) break;
+        heap->entries[i] = heap->entries[child];
+        i = child;
+    }
+    if(heap->len > 0) heap->entries[i] = last;
+    return 1;
+}
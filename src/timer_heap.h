@@ -0,0 +1,83 @@
+/*
+@file timer_heap.h
+@brief binary min-heap of deadlines, used for per-packet retransmission timers
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef TIMER_HEAP_H
+#define TIMER_HEAP_H
+
+#include <stdint.h>
+
+/*
+@brief a deadline and the key (e.g. sequence number) it belongs to
+
+Entries are never removed early; the owner re-arms by pushing a new
+entry and skips popped entries whose deadline no longer matches.
+*/
+struct timer_entry {
+    uint64_t deadline_us;
+    long long key;
+};
+
+/*
+@brief growable array-backed min-heap ordered by deadline
+*/
+struct timer_heap {
+    struct timer_entry *entries;
+    int len;
+    int cap;
+};
+
+/*
+@brief allocates an empty heap
+
+@param heap: the heap to initialize
+@param cap: the initial capacity, the heap grows past it as needed
+
+@return 0 in case of failure, 1 in case of success
+*/
+int timer_heap_init(struct timer_heap *heap, int cap);
+
+/*
+@brief releases the heap's storage
+
+@param heap: the heap
+*/
+void timer_heap_free(struct timer_heap *heap);
+
+/*
+@brief adds a deadline
+
+@param heap: the heap
+@param deadline_us: when the timer fires
+@param key: what the timer belongs to
+
+@return 0 in case of failure, 1 in case of success
+*/
+int timer_heap_push(struct timer_heap *heap, uint64_t deadline_us, long long key);
+
+/*
+@brief reads the earliest deadline without removing it
+
+@param heap: the heap
+@param out: where to store the entry
+
+@return 0 if the heap is empty, 1 otherwise
+*/
+int timer_heap_peek(const struct timer_heap *heap, struct timer_entry *out);
+
+/*
+@brief removes the earliest deadline
+
+@param heap: the heap
+@param out: where to store the entry, may be NULL
+
+@return 0 if the heap is empty, 1 otherwise
+*/
+int timer_heap_pop(struct timer_heap *heap, struct timer_entry *out);
+
+#endif
@@ -0,0 +1,60 @@
+/*
+@file token_bucket.c
+@brief token bucket rate limiter on the monotonic clock
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#include "clock.h"
+#include "token_bucket.h"
+
+void token_bucket_init(struct token_bucket *tb, uint64_t rate, double burst){
+    tb->rate = rate;
+    tb->burst = burst > 0 ? burst : 1;
+    tb->tokens = tb->burst;
+    tb->last_ns = monotonic_ns();
+}
+
+/*
+@brief adds the tokens earned since the last refill
+
+@param tb: the bucket
+@param now_ns: the current monotonic time
+*/
+static void refill(struct token_bucket *tb, uint64_t now_ns){
+    if(now_ns > tb->last_ns){
+        tb->tokens += (double)(now_ns - tb->last_ns) * tb->rate / 1e9;
+        if(tb->tokens > tb->burst) tb->tokens = tb->burst;
+    }
+    tb->last_ns = now_ns;
+}
+
+void token_bucket_set_rate(struct token_bucket *tb, uint64_t rate, double burst){
+    if(tb->rate != 0) refill(tb, monotonic_ns());
+    else tb->last_ns = monotonic_ns();
+    tb->rate = rate;
+    tb->burst = burst > 0 ? burst : 1;
+    if(tb->tokens > tb->burst) tb->tokens = tb->burst;
+}
+
+uint64_t token_bucket_delay(struct token_bucket *tb){
+    if(tb->rate == 0) return 0;
+    refill(tb, monotonic_ns());
+    if(tb->tokens >= 0) return 0;
+    return (uint64_t)(-tb->tokens * 1e9 / tb->rate);
+}
+
+uint64_t token_bucket_take(struct token_bucket *tb, double tokens){
+    if(tb->rate == 0) return 0;
+    refill(tb, monotonic_ns());
+    tb->tokens -= tokens;
+    if(tb->tokens >= 0) return 0;
+    return (uint64_t)(-tb->tokens * 1e9 / tb->rate);
+}
+
+void token_bucket_wait(struct token_bucket *tb, double tokens){
+    uint64_t wait = token_bucket_take(tb, tokens);
+    if(wait > 0) sleep_until_ns(tb->last_ns + wait);
+}
@@ -0,0 +1,74 @@
+/*
+@file token_bucket.h
+@brief token bucket rate limiter on the monotonic clock
+@author Ammar Sallam (asallam02)
+@author Yahya Abulmagd (YahyaMajd)
+
+@bugs no known bugs
+*/
+
+#ifndef TOKEN_BUCKET_H
+#define TOKEN_BUCKET_H
+
+#include <stdint.h>
+
+/*
+@brief a bucket refilled at rate tokens per second, holding at most burst
+
+Tokens are usually bytes. A caller may take more than the bucket holds,
+the bucket then goes into debt and the next taker waits it off, so a
+whole batch is charged at once instead of being cut into pieces.
+*/
+struct token_bucket {
+    uint64_t rate;          // tokens per second, 0 for no limit
+    double burst;
+    double tokens;
+    uint64_t last_ns;
+};
+
+/*
+@brief initializes a full bucket
+
+@param tb: the bucket
+@param rate: tokens per second, 0 for no limit
+@param burst: the most tokens saved up while idle
+*/
+void token_bucket_init(struct token_bucket *tb, uint64_t rate, double burst);
+
+/*
+@brief changes the rate, crediting the tokens earned at the old one first
+
+@param tb: the bucket
+@param rate: tokens per second, 0 for no limit
+@param burst: the most tokens saved up while idle
+*/
+void token_bucket_set_rate(struct token_bucket *tb, uint64_t rate, double burst);
+
+/*
+@brief how long until the bucket is out of debt, without taking anything
+
+@param tb: the bucket
+
+@return the wait in nanoseconds, 0 if tokens may be taken now
+*/
+uint64_t token_bucket_delay(struct token_bucket *tb);
+
+/*
+@brief takes tokens without waiting
+
+@param tb: the bucket
+@param tokens: how many to take
+
+@return how long to wait in nanoseconds before the bucket is out of debt, 0 if it isn't
+*/
+uint64_t token_bucket_take(struct token_bucket *tb, double tokens);
+
+/*
+@brief takes tokens, sleeping until the rate allows them
+
+@param tb: the bucket
+@param tokens: how many to take
+*/
+void token_bucket_wait(struct token_bucket *tb, double tokens);
+
+#endif